@@ -5,235 +5,75 @@
 #include <tools/tools.h>
 
 // -----------------------------------------------------------------------------
-// Trinary + 0 argument + logicals converted to integer
-
-#define DISPATCH_TRINARY_NO_LOGICAL(OUT, FUN, X, Y, Z)                \
-  if (Rf_isNull(X) || Rf_isNull(Y) || Rf_isNull(Z)) {                 \
-    return Rcpp::as<Rcpp::RObject>(R_NilValue);                       \
-  }                                                                   \
-                                                                      \
-  int x_type = TYPEOF(X);                                             \
-                                                                      \
-  if (x_type == REALSXP) {                                            \
-    OUT = FUN(                                                        \
-      xt::rarray<double>(X),                                          \
-      xt::rarray<double>(Y),                                          \
-      xt::rarray<double>(Z)                                           \
-    );                                                                \
-  }                                                                   \
-  else if (x_type == INTSXP) {                                        \
-    OUT = FUN(                                                        \
-      xt::rarray<int>(X),                                             \
-      xt::rarray<int>(Y),                                             \
-      xt::rarray<int>(Z)                                              \
-    );                                                                \
-  }                                                                   \
-  else if (x_type == LGLSXP) {                                        \
-    xt::rarray<int> X_int = xt::cast<int>(xt::rarray<rlogical>(X));   \
-    xt::rarray<int> Y_int = xt::cast<int>(xt::rarray<rlogical>(Y));   \
-    xt::rarray<int> Z_int = xt::cast<int>(xt::rarray<rlogical>(Z));   \
-    OUT = FUN(                                                        \
-      X_int,                                                          \
-      Y_int,                                                          \
-      Z_int                                                           \
-    );                                                                \
-  }                                                                   \
-  else {                                                              \
-    error_unknown_type();                                             \
+// Type dispatch
+//
+// `rray__dispatch_unary()`, `rray__dispatch_binary()` and
+// `rray__dispatch_trinary()` look at the type of `x`, wrap `x` (and `y`,
+// `z`) in an `xt::rarray<T>` of that type, and call `f` with them followed
+// by any extra `args`. All arrays are assumed to already share the type of
+// `x`.
+//
+// `f` is usually an overloaded `_impl()` function, lifted into a generic
+// lambda with `RRAY_LIFT()`:
+//
+// out = rray__dispatch_unary(RRAY_LIFT(rray__flip_impl), x, axis);
+
+#define RRAY_LIFT(FUN)                                           \
+  [&](auto&&... args) {                                          \
+    return FUN(std::forward<decltype(args)>(args)...);           \
   }
 
-// -----------------------------------------------------------------------------
-
-#define DISPATCH_BINARY(OUT, FUN, X, Y)                          \
-  int x_type = TYPEOF(X);                                        \
-                                                                 \
-  if (x_type == REALSXP) {                                       \
-    OUT = FUN(                                                   \
-      xt::rarray<double>(X),                                     \
-      xt::rarray<double>(Y)                                      \
-    );                                                           \
-  }                                                              \
-  else if (x_type == INTSXP) {                                   \
-    OUT = FUN(                                                   \
-      xt::rarray<int>(X),                                        \
-      xt::rarray<int>(Y)                                         \
-    );                                                           \
-  }                                                              \
-  else if (x_type == LGLSXP) {                                   \
-    OUT = FUN(                                                   \
-      xt::rarray<rlogical>(X),                                   \
-      xt::rarray<rlogical>(Y)                                    \
-    );                                                           \
-  }                                                              \
-  else {                                                         \
-    error_unknown_type();                                        \
+template <typename T>
+struct rray_type {
+  typedef T type;
+};
+
+// Call `f` with an `rray_type<T>` tag matching the SEXPTYPE `type`
+template <class F>
+inline Rcpp::RObject rray__visit_type(int type, F f) {
+  switch (type) {
+  case REALSXP: return f(rray_type<double>());
+  case INTSXP: return f(rray_type<int>());
+  case LGLSXP: return f(rray_type<rlogical>());
+  default: error_unknown_type();
   }
+}
 
-// -----------------------------------------------------------------------------
+template <class F, class... Args>
+inline Rcpp::RObject rray__dispatch_unary(F f, SEXP x, Args&&... args) {
+  return rray__visit_type(TYPEOF(x), [&](auto tag) {
+    using T = typename decltype(tag)::type;
 
-#define DISPATCH_BINARY_ONE(OUT, FUN, X, Y, ARG)               \
-  int x_type = TYPEOF(X);                                      \
-                                                               \
-  if (x_type == REALSXP) {                                     \
-    OUT = FUN(                                                 \
-      xt::rarray<double>(X),                                   \
-      xt::rarray<double>(Y),                                   \
-      ARG                                                      \
-    );                                                         \
-  }                                                            \
-  else if (x_type == INTSXP) {                                 \
-    OUT = FUN(                                                 \
-      xt::rarray<int>(X),                                      \
-      xt::rarray<int>(Y),                                      \
-      ARG                                                      \
-    );                                                         \
-  }                                                            \
-  else if (x_type == LGLSXP) {                                 \
-    OUT = FUN(                                                 \
-      xt::rarray<rlogical>(X),                                 \
-      xt::rarray<rlogical>(Y),                                 \
-      ARG                                                      \
-    );                                                         \
-  }                                                            \
-  else {                                                       \
-    error_unknown_type();                                      \
-  }
+    Rcpp::RObject out;
+    out = f(xt::rarray<T>(x), std::forward<Args>(args)...);
 
-// -----------------------------------------------------------------------------
+    return out;
+  });
+}
 
-#define DISPATCH_BINARY_TWO(OUT, FUN, X, Y, ARG1, ARG2)          \
-  int x_type = TYPEOF(X);                                        \
-                                                                 \
-  if (x_type == REALSXP) {                                       \
-    OUT = FUN(                                                   \
-      xt::rarray<double>(X),                                     \
-      xt::rarray<double>(Y),                                     \
-      ARG1, ARG2                                                 \
-    );                                                           \
-  }                                                              \
-  else if (x_type == INTSXP) {                                   \
-    OUT = FUN(                                                   \
-      xt::rarray<int>(X),                                        \
-      xt::rarray<int>(Y),                                        \
-      ARG1, ARG2                                                 \
-    );                                                           \
-  }                                                              \
-  else if (x_type == LGLSXP) {                                   \
-    OUT = FUN(                                                   \
-      xt::rarray<rlogical>(X),                                   \
-      xt::rarray<rlogical>(Y),                                   \
-      ARG1, ARG2                                                 \
-    );                                                           \
-  }                                                              \
-  else {                                                         \
-    error_unknown_type();                                        \
-  }
+template <class F, class... Args>
+inline Rcpp::RObject rray__dispatch_binary(F f, SEXP x, SEXP y, Args&&... args) {
+  return rray__visit_type(TYPEOF(x), [&](auto tag) {
+    using T = typename decltype(tag)::type;
 
+    Rcpp::RObject out;
+    out = f(xt::rarray<T>(x), xt::rarray<T>(y), std::forward<Args>(args)...);
 
-// -----------------------------------------------------------------------------
+    return out;
+  });
+}
 
-#define DISPATCH_UNARY(OUT, FUN, X)                                \
-  int x_type = TYPEOF(X);                                          \
-                                                                   \
-  if (x_type == REALSXP) {                                         \
-    OUT = FUN(                                                     \
-      xt::rarray<double>(X)                                        \
-    );                                                             \
-  }                                                                \
-  else if (x_type == INTSXP) {                                     \
-    OUT = FUN(                                                     \
-      xt::rarray<int>(X)                                           \
-    );                                                             \
-  }                                                                \
-  else if (x_type == LGLSXP) {                                     \
-    OUT = FUN(                                                     \
-      xt::rarray<rlogical>(X)                                      \
-    );                                                             \
-  }                                                                \
-  else {                                                           \
-    error_unknown_type();                                          \
-  }
+template <class F, class... Args>
+inline Rcpp::RObject rray__dispatch_trinary(F f, SEXP x, SEXP y, SEXP z, Args&&... args) {
+  return rray__visit_type(TYPEOF(x), [&](auto tag) {
+    using T = typename decltype(tag)::type;
 
-// -----------------------------------------------------------------------------
-
-#define DISPATCH_UNARY_ONE(OUT, FUN, X, ARG)                      \
-  int x_type = TYPEOF(X);                                         \
-                                                                  \
-  if (x_type == REALSXP) {                                        \
-    OUT = FUN(                                                    \
-      xt::rarray<double>(X),                                      \
-      ARG                                                         \
-    );                                                            \
-  }                                                               \
-  else if (x_type == INTSXP) {                                    \
-    OUT = FUN(                                                    \
-      xt::rarray<int>(X),                                         \
-      ARG                                                         \
-    );                                                            \
-  }                                                               \
-  else if (x_type == LGLSXP) {                                    \
-    OUT = FUN(                                                    \
-      xt::rarray<rlogical>(X),                                    \
-      ARG                                                         \
-    );                                                            \
-  }                                                               \
-  else {                                                          \
-    error_unknown_type();                                         \
-  }
-
-// -----------------------------------------------------------------------------
+    Rcpp::RObject out;
+    out = f(xt::rarray<T>(x), xt::rarray<T>(y), xt::rarray<T>(z), std::forward<Args>(args)...);
 
-#define DISPATCH_UNARY_TWO(OUT, FUN, X, ARG1, ARG2)                    \
-  int x_type = TYPEOF(X);                                              \
-                                                                       \
-  if (x_type == REALSXP) {                                             \
-    OUT = FUN(                                                         \
-      xt::rarray<double>(X),                                           \
-      ARG1, ARG2                                                       \
-    );                                                                 \
-  }                                                                    \
-  else if (x_type == INTSXP) {                                         \
-    OUT = FUN(                                                         \
-      xt::rarray<int>(X),                                              \
-      ARG1, ARG2                                                       \
-    );                                                                 \
-  }                                                                    \
-  else if (x_type == LGLSXP) {                                         \
-    OUT = FUN(                                                         \
-      xt::rarray<rlogical>(X),                                         \
-      ARG1, ARG2                                                       \
-    );                                                                 \
-  }                                                                    \
-  else {                                                               \
-    error_unknown_type();                                              \
-  }
-
-// -----------------------------------------------------------------------------
-
-#define DISPATCH_UNARY_THREE(OUT, FUN, X, ARG1, ARG2, ARG3)          \
-  int x_type = TYPEOF(X);                                            \
-                                                                     \
-  if (x_type == REALSXP) {                                           \
-    OUT = FUN(                                                       \
-      xt::rarray<double>(X),                                         \
-      ARG1, ARG2, ARG3                                               \
-    );                                                               \
-  }                                                                  \
-  else if (x_type == INTSXP) {                                       \
-    OUT = FUN(                                                       \
-      xt::rarray<int>(X),                                            \
-      ARG1, ARG2, ARG3                                               \
-    );                                                               \
-  }                                                                  \
-  else if (x_type == LGLSXP) {                                       \
-    OUT = FUN(                                                       \
-      xt::rarray<rlogical>(X),                                       \
-      ARG1, ARG2, ARG3                                               \
-    );                                                               \
-  }                                                                  \
-  else {                                                             \
-    error_unknown_type();                                            \
-  }
+    return out;
+  });
+}
 
 // -----------------------------------------------------------------------------
 
@@ -242,29 +82,27 @@
     return X;                                                    \
   }                                                              \
                                                                  \
-  Rcpp::RObject out;                                             \
-  DISPATCH_UNARY(out, FUN, X);                                   \
+  Rcpp::RObject out = rray__dispatch_unary(RRAY_LIFT(FUN), X);  \
                                                                  \
   rray__set_dim_names(out, rray__dim_names(X));                  \
   return out
 
 // -----------------------------------------------------------------------------
 
-#define DISPATCH_BINARY_MATH(FUN, X, Y)                          \
-  if (r_is_null(X) || r_is_null(Y)) {                            \
-    return R_NilValue;                                           \
-  }                                                              \
-                                                                 \
-  Rcpp::List new_dim_names = rray__dim_names2(X, Y);             \
-                                                                 \
-  Rcpp::RObject type = vec__ptype_inner2(X, Y);                  \
-  X = vec__cast_inner(X, type);                                  \
-  Y = vec__cast_inner(Y, type);                                  \
-                                                                 \
-  Rcpp::RObject out;                                             \
-  DISPATCH_BINARY(out, FUN, X, Y);                               \
-                                                                 \
-  rray__set_dim_names(out, new_dim_names);                       \
+#define DISPATCH_BINARY_MATH(FUN, X, Y)                            \
+  if (r_is_null(X) || r_is_null(Y)) {                              \
+    return R_NilValue;                                             \
+  }                                                                \
+                                                                   \
+  Rcpp::List new_dim_names = rray__dim_names2(X, Y);               \
+                                                                   \
+  Rcpp::RObject type = vec__ptype_inner2(X, Y);                    \
+  X = vec__cast_inner(X, type);                                    \
+  Y = vec__cast_inner(Y, type);                                    \
+                                                                   \
+  Rcpp::RObject out = rray__dispatch_binary(RRAY_LIFT(FUN), X, Y); \
+                                                                   \
+  rray__set_dim_names(out, new_dim_names);                         \
   return out
 
 // -----------------------------------------------------------------------------
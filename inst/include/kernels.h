@@ -0,0 +1,78 @@
+#ifndef rray_kernels_h
+#define rray_kernels_h
+
+#include <rray.h>
+
+// -----------------------------------------------------------------------------
+// Binary kernel table
+//
+// A binary kernel computes the broadcast result of an elementwise operation
+// on two arrays that already share the same inner type. Dimension names and
+// casting are left to the caller. Looking up a kernel with
+// `rray__binary_kernel()` once and calling it repeatedly avoids paying for
+// the type dispatch on every call.
+
+typedef Rcpp::RObject (*rray_binary_kernel)(SEXP x, SEXP y);
+
+// Keep in sync with `rray_binary_kernel_table` in src/kernels.cpp
+enum rray_binary_op {
+  rray_op_add = 0,
+  rray_op_subtract,
+  rray_op_multiply,
+  rray_op_divide,
+  rray_op_pow,
+  rray_op_maximum,
+  rray_op_minimum,
+  rray_op_hypot,
+  rray_op_greater,
+  rray_op_greater_equal,
+  rray_op_lesser,
+  rray_op_lesser_equal,
+  rray_op_equal,
+  rray_op_not_equal,
+  rray_op_logical_and,
+  rray_op_logical_or,
+  rray_n_binary_ops
+};
+
+// One kernel per inner type, in the order double, integer, logical.
+// `NULL` for types the operation isn't defined for.
+typedef rray_binary_kernel rray_binary_kernels[3];
+
+#define RRAY_BINARY_KERNEL(FUN, T)                               \
+  [](SEXP x, SEXP y) {                                           \
+    Rcpp::RObject out;                                           \
+    out = FUN(xt::rarray<T>(x), xt::rarray<T>(y));               \
+    return out;                                                  \
+  }
+
+#define RRAY_BINARY_KERNELS(FUN) {                               \
+  RRAY_BINARY_KERNEL(FUN, double),                               \
+  RRAY_BINARY_KERNEL(FUN, int),                                  \
+  RRAY_BINARY_KERNEL(FUN, rlogical)                              \
+}
+
+// Returns `NULL` when `op` isn't defined for `type`
+rray_binary_kernel rray__binary_kernel(rray_binary_op op, SEXPTYPE type);
+
+// -----------------------------------------------------------------------------
+// Defined alongside the corresponding `_impl()` functions
+
+extern const rray_binary_kernels rray_add_kernels;
+extern const rray_binary_kernels rray_subtract_kernels;
+extern const rray_binary_kernels rray_multiply_kernels;
+extern const rray_binary_kernels rray_divide_kernels;
+extern const rray_binary_kernels rray_pow_kernels;
+extern const rray_binary_kernels rray_maximum_kernels;
+extern const rray_binary_kernels rray_minimum_kernels;
+extern const rray_binary_kernels rray_hypot_kernels;
+extern const rray_binary_kernels rray_greater_kernels;
+extern const rray_binary_kernels rray_greater_equal_kernels;
+extern const rray_binary_kernels rray_lesser_kernels;
+extern const rray_binary_kernels rray_lesser_equal_kernels;
+extern const rray_binary_kernels rray_equal_kernels;
+extern const rray_binary_kernels rray_not_equal_kernels;
+extern const rray_binary_kernels rray_logical_and_kernels;
+extern const rray_binary_kernels rray_logical_or_kernels;
+
+#endif
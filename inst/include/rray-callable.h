@@ -0,0 +1,25 @@
+#ifndef rray_callable_h
+#define rray_callable_h
+
+// Reducing functions that other packages can provide to `rray_reduce()`.
+//
+// A package registers a function with this signature when it is loaded,
+// usually from its `R_init_<pkg>()` routine:
+//
+//   R_RegisterCCallable("mypkg", "my_op", (DL_FUNC) &my_op);
+//
+// and it is then used with `rray_reducer_callable("mypkg", "my_op", init)`.
+//
+// The function combines the accumulated value `acc` with the next value `x`
+// and returns the new accumulated value. Integers and logicals are passed as
+// doubles, with missing values as `NA_REAL`.
+//
+// Every output cell starts from `init`, and partial results computed by
+// different threads are combined with the function itself. It must
+// therefore be associative and commutative with `init` as its identity, it
+// must be safe to call from several threads at once, and it must not call
+// the R API.
+
+typedef double (*rray_reduce_fn)(double acc, double x);
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef rray_elementwise_h
+#define rray_elementwise_h
+
+#include <rray.h>
+#include <tools/parallel.h>
+#include <tools/simd.h>
+#include <tools/template-utils.h>
+
+// Required for writing directly into an existing array
+#include <xtensor/xnoalias.hpp>
+
+// -----------------------------------------------------------------------------
+// Elementwise kernels
+//
+// Most elementwise operations are called with inputs that either have the
+// same shape as the result, or are a single value. In that case, the
+// operation is applied with a plain loop over the underlying memory, which
+// can be split across threads.
+//
+// Binary operations also handle broadcasting this way. The leading axes of
+// the result are merged into runs along which each input is either
+// contiguous or constant (a column of a matrix against a column vector or a
+// row vector, for example), and the flat loop is run on each of them. Only
+// when those runs are very short is the xtensor broadcasting machinery used
+// instead.
+
+template <typename T> struct rray_storage;
+
+template <> struct rray_storage<double> {
+  typedef double type;
+  static const SEXPTYPE sexptype = REALSXP;
+  static double* ptr(SEXP x) { return REAL(x); }
+};
+
+template <> struct rray_storage<int> {
+  typedef int type;
+  static const SEXPTYPE sexptype = INTSXP;
+  static int* ptr(SEXP x) { return INTEGER(x); }
+};
+
+template <> struct rray_storage<rlogical> {
+  typedef int type;
+  static const SEXPTYPE sexptype = LGLSXP;
+  static int* ptr(SEXP x) { return LOGICAL(x); }
+};
+
+inline R_xlen_t rray__dim_size(const Rcpp::IntegerVector& dim) {
+  R_xlen_t size = 1;
+
+  for (int i = 0; i < dim.size(); ++i) {
+    size *= dim[i];
+  }
+
+  return size;
+}
+
+// The result is written into `x` when `in_place` is set, otherwise into a
+// fresh array of type `R` with dimensions `dim`.
+template <typename R, typename T>
+inline Rcpp::RObject rray__elementwise_out(const xt::rarray<T>& x,
+                                           const Rcpp::IntegerVector& dim,
+                                           R_xlen_t size,
+                                           bool in_place) {
+  if (in_place) {
+    return Rcpp::RObject(SEXP(x));
+  }
+
+  Rcpp::RObject out = Rf_allocVector(rray_storage<R>::sexptype, size);
+  out.attr("dim") = dim;
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+// Flat loops
+//
+// Each loop is defined once per instruction set, see `tools/simd.h`. Separate
+// loops for the single value cases keep them simple enough for the compiler
+// to vectorize.
+
+#define RRAY_DEFINE_LOOP2(NAME, TARGET)                                      \
+template <typename R, typename T, class F>                                   \
+TARGET void NAME(R* p_out,                                                   \
+                 const T* p_x,                                               \
+                 const T* p_y,                                               \
+                 bool x_step,                                                \
+                 bool y_step,                                                \
+                 R_xlen_t begin,                                             \
+                 R_xlen_t end,                                               \
+                 F f) {                                                      \
+  if (x_step && y_step) {                                                    \
+    RRAY_PRAGMA_SIMD                                                         \
+    for (R_xlen_t i = begin; i < end; ++i) p_out[i] = f(p_x[i], p_y[i]);     \
+  }                                                                          \
+  else if (x_step) {                                                         \
+    const T y_0 = p_y[0];                                                    \
+    RRAY_PRAGMA_SIMD                                                         \
+    for (R_xlen_t i = begin; i < end; ++i) p_out[i] = f(p_x[i], y_0);        \
+  }                                                                          \
+  else if (y_step) {                                                         \
+    const T x_0 = p_x[0];                                                    \
+    RRAY_PRAGMA_SIMD                                                         \
+    for (R_xlen_t i = begin; i < end; ++i) p_out[i] = f(x_0, p_y[i]);        \
+  }                                                                          \
+  else {                                                                     \
+    const R value = f(p_x[0], p_y[0]);                                       \
+    std::fill(p_out + begin, p_out + end, value);                            \
+  }                                                                          \
+}
+
+RRAY_DEFINE_LOOP2(rray__loop2_baseline, )
+RRAY_DEFINE_LOOP2(rray__loop2_avx2, RRAY_TARGET_AVX2)
+RRAY_DEFINE_LOOP2(rray__loop2_avx512, RRAY_TARGET_AVX512)
+
+#undef RRAY_DEFINE_LOOP2
+
+#ifdef RRAY_SIMD_DISPATCH
+#define RRAY_DISPATCH_SIMD(LOOP, ...)                                        \
+  switch (rray_simd_level) {                                                 \
+  case rray_simd_avx512: LOOP##_avx512(__VA_ARGS__); break;                  \
+  case rray_simd_avx2: LOOP##_avx2(__VA_ARGS__); break;                      \
+  default: LOOP##_baseline(__VA_ARGS__);                                     \
+  }
+#else
+#define RRAY_DISPATCH_SIMD(LOOP, ...) LOOP##_baseline(__VA_ARGS__)
+#endif
+
+// -----------------------------------------------------------------------------
+// Strided broadcasting
+
+// Runs shorter than this aren't worth the bookkeeping, xtensor is used instead
+const R_xlen_t rray_strided_min_run = 8;
+
+// Strides of `x` within a result of dimensions `dim`. Axes that `x` is
+// broadcast along have a stride of 0.
+inline std::vector<R_xlen_t> rray__broadcast_strides(SEXP x,
+                                                     const Rcpp::IntegerVector& dim) {
+  const int& dim_n = dim.size();
+  Rcpp::IntegerVector x_dim = rray__increase_dims(rray__dim(x), dim_n);
+
+  std::vector<R_xlen_t> strides(dim_n);
+  R_xlen_t stride = 1;
+
+  for (int i = 0; i < dim_n; ++i) {
+    strides[i] = (x_dim[i] == 1) ? 0 : stride;
+    stride *= x_dim[i];
+  }
+
+  return strides;
+}
+
+// The result is processed as `run` contiguous elements at a time. Within a
+// run, `x` and `y` are either contiguous (step of 1) or constant (step of 0).
+// The remaining axes are walked with an odometer.
+
+struct rray_strided_plan {
+  R_xlen_t run;
+  bool x_step;
+  bool y_step;
+  std::vector<R_xlen_t> outer_dim;
+  std::vector<R_xlen_t> x_strides;
+  std::vector<R_xlen_t> y_strides;
+};
+
+inline rray_strided_plan rray__strided_plan(SEXP x,
+                                            SEXP y,
+                                            const Rcpp::IntegerVector& dim) {
+
+  const int& dim_n = dim.size();
+  std::vector<R_xlen_t> x_strides = rray__broadcast_strides(x, dim);
+  std::vector<R_xlen_t> y_strides = rray__broadcast_strides(y, dim);
+
+  rray_strided_plan plan;
+  plan.run = 1;
+  plan.x_step = false;
+  plan.y_step = false;
+
+  bool started = false;
+  int i = 0;
+
+  // Merge leading axes as long as each input keeps the same step.
+  // Axes of size 1 don't affect the steps.
+  for (; i < dim_n; ++i) {
+    if (dim[i] == 1) {
+      continue;
+    }
+
+    bool x_step = x_strides[i] != 0;
+    bool y_step = y_strides[i] != 0;
+
+    if (!started) {
+      plan.x_step = x_step;
+      plan.y_step = y_step;
+      started = true;
+    }
+    else if (x_step != plan.x_step || y_step != plan.y_step) {
+      break;
+    }
+
+    plan.run *= dim[i];
+  }
+
+  for (; i < dim_n; ++i) {
+    plan.outer_dim.push_back(dim[i]);
+    plan.x_strides.push_back(x_strides[i]);
+    plan.y_strides.push_back(y_strides[i]);
+  }
+
+  return plan;
+}
+
+// Apply the flat loop to the result positions `[begin, end)`
+
+template <typename R, typename T, class F>
+inline void rray__strided_loop2(const rray_strided_plan& plan,
+                                R* p_out,
+                                const T* p_x,
+                                const T* p_y,
+                                R_xlen_t begin,
+                                R_xlen_t end,
+                                F f) {
+
+  if (begin >= end) {
+    return;
+  }
+
+  const int outer_n = plan.outer_dim.size();
+  std::vector<R_xlen_t> idx(outer_n);
+
+  // Locate `begin` in the result and in both inputs
+  R_xlen_t inner = begin % plan.run;
+  R_xlen_t outer = begin / plan.run;
+  R_xlen_t x_offset = 0;
+  R_xlen_t y_offset = 0;
+
+  for (int j = 0; j < outer_n; ++j) {
+    idx[j] = outer % plan.outer_dim[j];
+    outer = outer / plan.outer_dim[j];
+    x_offset += idx[j] * plan.x_strides[j];
+    y_offset += idx[j] * plan.y_strides[j];
+  }
+
+  R_xlen_t pos = begin;
+
+  while (pos < end) {
+    R_xlen_t n = std::min(plan.run - inner, end - pos);
+
+    const T* p_x_run = p_x + x_offset + (plan.x_step ? inner : 0);
+    const T* p_y_run = p_y + y_offset + (plan.y_step ? inner : 0);
+
+    RRAY_DISPATCH_SIMD(rray__loop2, p_out + pos, p_x_run, p_y_run, plan.x_step, plan.y_step, 0, n, f);
+
+    pos += n;
+    inner = 0;
+
+    // Move to the next run, carrying over into the next axes
+    for (int j = 0; j < outer_n; ++j) {
+      idx[j]++;
+      x_offset += plan.x_strides[j];
+      y_offset += plan.y_strides[j];
+
+      if (idx[j] < plan.outer_dim[j]) {
+        break;
+      }
+
+      x_offset -= idx[j] * plan.x_strides[j];
+      y_offset -= idx[j] * plan.y_strides[j];
+      idx[j] = 0;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// `expr` can be `rray_no_xtensor()` when `f` has no xtensor equivalent, in
+// which case the strided loop is always used.
+
+struct rray_no_xtensor {};
+
+template <class G>
+struct rray_has_xtensor : std::integral_constant<bool, !std::is_same<G, rray_no_xtensor>::value> {};
+
+template <typename R, typename T, class G>
+Rcpp::RObject rray__elementwise2_xtensor(const xt::rarray<T>& x,
+                                         const xt::rarray<T>& y,
+                                         bool in_place,
+                                         G expr) {
+
+  auto views = rray__increase_dims_view2(x, y);
+  auto x_view = std::get<0>(views);
+  auto y_view = std::get<1>(views);
+
+  if (in_place) {
+    xt::rarray<R> res(SEXP(x));
+    xt::noalias(res) = expr(x_view, y_view);
+    return Rcpp::as<Rcpp::RObject>(res);
+  }
+
+  xt::rarray<R> res = expr(x_view, y_view);
+  return Rcpp::as<Rcpp::RObject>(res);
+}
+
+template <typename R, typename T>
+Rcpp::RObject rray__elementwise2_xtensor(const xt::rarray<T>& x,
+                                         const xt::rarray<T>& y,
+                                         bool in_place,
+                                         rray_no_xtensor expr) {
+  Rcpp::stop("Internal error: No xtensor fallback is available.");
+}
+
+// Apply `f` to every pair of elements of the broadcast `x` and `y`. `expr`
+// builds the equivalent xtensor expression from broadcastable views of `x`
+// and `y`, and is used as the fallback when the strided runs are too short.
+// `f` must not touch the R API, as it can be called from multiple threads.
+
+template <typename R, typename T, class F, class G>
+Rcpp::RObject rray__elementwise2(const xt::rarray<T>& x,
+                                 const xt::rarray<T>& y,
+                                 bool in_place,
+                                 F f,
+                                 G expr) {
+
+  Rcpp::IntegerVector dim = rray__dim2(rray__dim(SEXP(x)), rray__dim(SEXP(y)));
+  R_xlen_t size = rray__dim_size(dim);
+
+  rray_strided_plan plan = rray__strided_plan(SEXP(x), SEXP(y), dim);
+
+  bool use_xtensor =
+    rray_has_xtensor<G>::value &&
+    size > 0 &&
+    plan.run < rray_strided_min_run &&
+    !plan.outer_dim.empty();
+
+  if (use_xtensor) {
+    return rray__elementwise2_xtensor<R>(x, y, in_place, expr);
+  }
+
+  Rcpp::RObject out = rray__elementwise_out<R>(x, dim, size, in_place);
+
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
+  const auto* p_y = rray_storage<T>::ptr(SEXP(y));
+  auto* p_out = rray_storage<R>::ptr(out);
+
+  // When `x` is reused, it has the dimensions of the result, so every
+  // element is read right before it is overwritten
+  rray__parallel_for(size, [&](R_xlen_t begin, R_xlen_t end) {
+    rray__strided_loop2(plan, p_out, p_x, p_y, begin, end, f);
+  });
+
+  return out;
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef rray_int_overflow_h
+#define rray_int_overflow_h
+
+#include <Rcpp.h>
+#include <atomic>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+// Integer arithmetic follows base R. A missing input gives a missing result,
+// and so does a result that doesn't fit in an integer. The computation is
+// done in 64 bits, which is exact for the sum, difference or product of
+// two integers.
+//
+// `overflow` is shared between threads. It is only written to when an
+// overflow occurs, so the common path doesn't pay for the atomic.
+
+inline int rray__int_checked(int64_t value,
+                             bool any_na,
+                             std::atomic<bool>& overflow) {
+
+  bool is_overflow = !any_na && (value > INT_MAX || value < -INT_MAX);
+
+  if (is_overflow) {
+    overflow.store(true, std::memory_order_relaxed);
+  }
+
+  return (any_na || is_overflow) ? NA_INTEGER : static_cast<int>(value);
+}
+
+inline void rray__warn_int_overflow(const std::atomic<bool>& overflow) {
+  if (overflow.load()) {
+    Rcpp::warning("NAs produced by integer overflow");
+  }
+}
+
+#endif
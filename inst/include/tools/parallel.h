@@ -0,0 +1,75 @@
+#ifndef rray_parallel_h
+#define rray_parallel_h
+
+#include <Rcpp.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Number of threads the kernels are allowed to use, set from R with
+// `rray_set_threads()`. Defaults to 1, so everything runs serially.
+extern int rray_n_threads;
+
+// Minimum number of elements each thread must be handed. Below this, the cost
+// of waking up threads outweighs the benefit.
+const R_xlen_t rray_parallel_grain = 32768;
+
+inline int rray__threads_for(R_xlen_t size) {
+  R_xlen_t n_chunks = size / rray_parallel_grain;
+
+  if (n_chunks < 2) {
+    return 1;
+  }
+
+  return static_cast<int>(std::min<R_xlen_t>(rray_n_threads, n_chunks));
+}
+
+// Split `[0, size)` into one contiguous range per thread and call
+// `f(begin, end)` on each of them. `f` is run outside of the main thread, so
+// it must not touch the R API or throw.
+
+template <class F>
+inline void rray__parallel_for(R_xlen_t size, F f) {
+  const int n_threads = rray__threads_for(size);
+
+  if (n_threads == 1) {
+    f(0, size);
+    return;
+  }
+
+  const R_xlen_t chunk = (size + n_threads - 1) / n_threads;
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(n_threads) schedule(static)
+#endif
+  for (int i = 0; i < n_threads; ++i) {
+    R_xlen_t begin = i * chunk;
+    R_xlen_t end = std::min(size, begin + chunk);
+
+    if (begin < end) {
+      f(begin, end);
+    }
+  }
+}
+
+// Call `f(i)` for every thread `i` in `[0, n_threads)`, for callers that
+// partition the work themselves. The same rules as `rray__parallel_for()`
+// apply to `f`.
+
+template <class F>
+inline void rray__parallel_each(int n_threads, F f) {
+  if (n_threads == 1) {
+    f(0);
+    return;
+  }
+
+#ifdef _OPENMP
+  #pragma omp parallel for num_threads(n_threads) schedule(static)
+#endif
+  for (int i = 0; i < n_threads; ++i) {
+    f(i);
+  }
+}
+
+#endif
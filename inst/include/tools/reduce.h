@@ -0,0 +1,574 @@
+#ifndef rray_tools_reduce_h
+#define rray_tools_reduce_h
+
+#include <rray.h>
+#include <tools/errors.h>
+#include <tools/parallel.h>
+#include <atomic>
+
+// -----------------------------------------------------------------------------
+// Reduction plans
+//
+// A reduction sends every element of `x` to the output cell it is reduced
+// into. Adjacent axes that are either all reduced or all kept are merged into
+// groups, and axes of size 1 are dropped, so that `x` is always read as runs
+// of `inner` contiguous elements:
+//
+// - If the inner group is reduced, the whole run is reduced into a single
+//   output cell.
+// - Otherwise, the run maps onto `inner` contiguous output cells.
+//
+// The remaining (outer) groups are walked with an odometer. Along reduced
+// groups, the output offset has a stride of 0.
+
+struct rray_reduce_plan {
+  Rcpp::IntegerVector out_dim;
+  R_xlen_t size;
+  R_xlen_t out_size;
+  R_xlen_t inner;
+  bool inner_reduced;
+  std::vector<R_xlen_t> outer_dim;
+  std::vector<R_xlen_t> outer_in_strides;
+  std::vector<R_xlen_t> outer_out_strides;
+};
+
+// `axes` are 0-based, `NULL` reduces over all axes. Reduced axes have a size
+// of 1 in the result.
+
+inline rray_reduce_plan rray__reduce_plan(const Rcpp::IntegerVector& dim,
+                                          Rcpp::RObject axes) {
+
+  const int& dim_n = dim.size();
+
+  std::vector<bool> is_reduced(dim_n, r_is_null(axes));
+
+  if (!r_is_null(axes)) {
+    Rcpp::IntegerVector r_axes(axes);
+
+    for (int axis : r_axes) {
+      is_reduced[axis] = true;
+    }
+  }
+
+  Rcpp::IntegerVector out_dim = Rcpp::clone(dim);
+
+  R_xlen_t size = 1;
+  R_xlen_t out_size = 1;
+
+  // Group extents and whether they are reduced, in memory order
+  std::vector<R_xlen_t> group_dim;
+  std::vector<bool> group_reduced;
+
+  for (int i = 0; i < dim_n; ++i) {
+    size *= dim[i];
+
+    if (is_reduced[i]) {
+      out_dim[i] = 1;
+    }
+    out_size *= out_dim[i];
+
+    if (dim[i] == 1) {
+      continue;
+    }
+
+    if (!group_dim.empty() && group_reduced.back() == is_reduced[i]) {
+      group_dim.back() *= dim[i];
+    }
+    else {
+      group_dim.push_back(dim[i]);
+      group_reduced.push_back(is_reduced[i]);
+    }
+  }
+
+  rray_reduce_plan plan;
+  plan.out_dim = out_dim;
+  plan.size = size;
+  plan.out_size = out_size;
+
+  if (group_dim.empty()) {
+    plan.inner = 1;
+    plan.inner_reduced = true;
+    return plan;
+  }
+
+  plan.inner = group_dim[0];
+  plan.inner_reduced = group_reduced[0];
+
+  R_xlen_t in_stride = plan.inner;
+  R_xlen_t out_stride = plan.inner_reduced ? 1 : plan.inner;
+
+  for (std::size_t i = 1; i < group_dim.size(); ++i) {
+    plan.outer_dim.push_back(group_dim[i]);
+    plan.outer_in_strides.push_back(in_stride);
+    plan.outer_out_strides.push_back(group_reduced[i] ? 0 : out_stride);
+
+    in_stride *= group_dim[i];
+
+    if (!group_reduced[i]) {
+      out_stride *= group_dim[i];
+    }
+  }
+
+  return plan;
+}
+
+// -----------------------------------------------------------------------------
+
+// Walks the positions of a set of axes in column major order, tracking the
+// offset of each position in one or two arrays
+
+struct rray_odometer {
+  std::vector<R_xlen_t> dim;
+  std::vector<R_xlen_t> strides_a;
+  std::vector<R_xlen_t> strides_b;
+  std::vector<R_xlen_t> idx;
+  R_xlen_t offset_a;
+  R_xlen_t offset_b;
+
+  rray_odometer(const std::vector<R_xlen_t>& dim,
+                const std::vector<R_xlen_t>& strides_a,
+                const std::vector<R_xlen_t>& strides_b) :
+    dim(dim),
+    strides_a(strides_a),
+    strides_b(strides_b),
+    idx(dim.size()),
+    offset_a(0),
+    offset_b(0) {}
+
+  // Jump to the `i`-th position
+  inline void seek(R_xlen_t i) {
+    offset_a = 0;
+    offset_b = 0;
+
+    for (std::size_t j = 0; j < dim.size(); ++j) {
+      idx[j] = i % dim[j];
+      i = i / dim[j];
+      offset_a += idx[j] * strides_a[j];
+      offset_b += idx[j] * strides_b[j];
+    }
+  }
+
+  inline void next() {
+    for (std::size_t j = 0; j < dim.size(); ++j) {
+      idx[j]++;
+      offset_a += strides_a[j];
+      offset_b += strides_b[j];
+
+      if (idx[j] < dim[j]) {
+        return;
+      }
+
+      offset_a -= idx[j] * strides_a[j];
+      offset_b -= idx[j] * strides_b[j];
+      idx[j] = 0;
+    }
+  }
+};
+
+// -----------------------------------------------------------------------------
+// Reduction engine
+//
+// `rray__reduce()` returns one accumulator per output cell. A reducer
+// provides:
+//
+// - `acc_type`, and `init()` returning an empty accumulator.
+// - `run(acc, p_x, n)`, reducing `n` contiguous elements into `acc`.
+// - `step(p_acc, p_x, n)`, reducing element `i` into `p_acc[i]`.
+// - `merge(acc, other)`, combining two partial accumulators.
+//
+// These are called from worker threads, so they must not touch the R API.
+//
+// When several threads are available, the work is split so that the inner
+// loops stay contiguous:
+//
+// 1. Across output cells, by the positions of the kept outer groups. Each
+//    thread walks all of the reduced groups for the cells it owns.
+// 2. Across the inner run, when it is kept. Every thread owns a slice of
+//    the contiguous output cells.
+// 3. Across runs, or across the elements of every run for full
+//    reductions, with one private set of accumulators per thread that are
+//    merged at the end.
+
+// Upper bound on the number of cells per private set of accumulators
+const R_xlen_t rray_reduce_max_private = 65536;
+
+template <class Reducer, typename S>
+inline void rray__reduce_segment(const rray_reduce_plan& plan,
+                                 const Reducer& reducer,
+                                 const S* p_x,
+                                 typename Reducer::acc_type* p_acc,
+                                 R_xlen_t in_offset,
+                                 R_xlen_t out_offset,
+                                 R_xlen_t begin,
+                                 R_xlen_t end) {
+  if (plan.inner_reduced) {
+    reducer.run(p_acc[out_offset], p_x + in_offset + begin, end - begin);
+  }
+  else {
+    reducer.step(p_acc + out_offset + begin, p_x + in_offset + begin, end - begin);
+  }
+}
+
+// Reduces the runs `[run_begin, run_end)`, restricted to the elements
+// `[begin, end)` of each run
+template <class Reducer, typename S>
+inline void rray__reduce_runs(const rray_reduce_plan& plan,
+                              const Reducer& reducer,
+                              const S* p_x,
+                              typename Reducer::acc_type* p_acc,
+                              R_xlen_t run_begin,
+                              R_xlen_t run_end,
+                              R_xlen_t begin,
+                              R_xlen_t end) {
+
+  rray_odometer outer(plan.outer_dim, plan.outer_in_strides, plan.outer_out_strides);
+  outer.seek(run_begin);
+
+  for (R_xlen_t run = run_begin; run < run_end; ++run) {
+    rray__reduce_segment(plan, reducer, p_x, p_acc, outer.offset_a, outer.offset_b, begin, end);
+    outer.next();
+  }
+}
+
+template <class Reducer, typename S>
+std::vector<typename Reducer::acc_type> rray__reduce(const rray_reduce_plan& plan,
+                                                     const Reducer& reducer,
+                                                     const S* p_x) {
+
+  typedef typename Reducer::acc_type acc_type;
+
+  std::vector<acc_type> acc(plan.out_size, reducer.init());
+
+  if (plan.size == 0) {
+    return acc;
+  }
+
+  const R_xlen_t n_runs = plan.size / plan.inner;
+  const int n_threads = rray__threads_for(plan.size);
+
+  if (n_threads == 1) {
+    rray__reduce_runs(plan, reducer, p_x, acc.data(), 0, n_runs, 0, plan.inner);
+    return acc;
+  }
+
+  // Split the outer groups into the kept ones and the reduced ones
+  std::vector<R_xlen_t> kept_dim, kept_in_strides, kept_out_strides;
+  std::vector<R_xlen_t> reduced_dim, reduced_in_strides, reduced_out_strides;
+
+  for (std::size_t j = 0; j < plan.outer_dim.size(); ++j) {
+    if (plan.outer_out_strides[j] == 0) {
+      reduced_dim.push_back(plan.outer_dim[j]);
+      reduced_in_strides.push_back(plan.outer_in_strides[j]);
+      reduced_out_strides.push_back(0);
+    }
+    else {
+      kept_dim.push_back(plan.outer_dim[j]);
+      kept_in_strides.push_back(plan.outer_in_strides[j]);
+      kept_out_strides.push_back(plan.outer_out_strides[j]);
+    }
+  }
+
+  R_xlen_t n_kept = 1;
+  for (R_xlen_t extent : kept_dim) n_kept *= extent;
+
+  const R_xlen_t n_reduced = n_runs / n_kept;
+
+  // 1. Every thread owns the output cells of a range of kept positions
+  if (n_kept >= n_threads) {
+    rray__parallel_each(n_threads, [&](int thread) {
+      const R_xlen_t kept_begin = n_kept * thread / n_threads;
+      const R_xlen_t kept_end = n_kept * (thread + 1) / n_threads;
+
+      rray_odometer kept(kept_dim, kept_in_strides, kept_out_strides);
+      rray_odometer reduced(reduced_dim, reduced_in_strides, reduced_out_strides);
+
+      kept.seek(kept_begin);
+
+      for (R_xlen_t k = kept_begin; k < kept_end; ++k) {
+        reduced.seek(0);
+
+        for (R_xlen_t r = 0; r < n_reduced; ++r) {
+          rray__reduce_segment(
+            plan, reducer, p_x, acc.data(),
+            kept.offset_a + reduced.offset_a, kept.offset_b,
+            0, plan.inner
+          );
+          reduced.next();
+        }
+
+        kept.next();
+      }
+    });
+
+    return acc;
+  }
+
+  // 2. Every thread owns a slice of the contiguous output cells
+  if (!plan.inner_reduced && plan.inner >= n_threads) {
+    rray__parallel_each(n_threads, [&](int thread) {
+      const R_xlen_t begin = plan.inner * thread / n_threads;
+      const R_xlen_t end = plan.inner * (thread + 1) / n_threads;
+
+      rray__reduce_runs(plan, reducer, p_x, acc.data(), 0, n_runs, begin, end);
+    });
+
+    return acc;
+  }
+
+  if (plan.out_size > rray_reduce_max_private) {
+    rray__reduce_runs(plan, reducer, p_x, acc.data(), 0, n_runs, 0, plan.inner);
+    return acc;
+  }
+
+  // 3. Private accumulators per thread, merged at the end
+  std::vector<std::vector<acc_type>> partials(n_threads);
+
+  const bool split_runs = n_runs >= n_threads;
+
+  rray__parallel_each(n_threads, [&](int thread) {
+    partials[thread].assign(plan.out_size, reducer.init());
+
+    if (split_runs) {
+      const R_xlen_t run_begin = n_runs * thread / n_threads;
+      const R_xlen_t run_end = n_runs * (thread + 1) / n_threads;
+
+      rray__reduce_runs(plan, reducer, p_x, partials[thread].data(), run_begin, run_end, 0, plan.inner);
+    }
+    else {
+      const R_xlen_t begin = plan.inner * thread / n_threads;
+      const R_xlen_t end = plan.inner * (thread + 1) / n_threads;
+
+      rray__reduce_runs(plan, reducer, p_x, partials[thread].data(), 0, n_runs, begin, end);
+    }
+  });
+
+  for (int thread = 0; thread < n_threads; ++thread) {
+    for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+      reducer.merge(acc[i], partials[thread][i]);
+    }
+  }
+
+  return acc;
+}
+
+// Allocates the double result of a reduction, with the dimensions of
+// `plan.out_dim`
+
+inline Rcpp::RObject rray__reduce_out(const rray_reduce_plan& plan, double value) {
+  Rcpp::RObject out = Rf_allocVector(REALSXP, plan.out_size);
+  std::fill(REAL(out), REAL(out) + plan.out_size, value);
+  out.attr("dim") = plan.out_dim;
+  return out;
+}
+
+// Reads an element as a double, logicals and integers have their missing
+// value converted
+inline double rray__as_double(double x) {
+  return x;
+}
+
+inline double rray__as_double(int x) {
+  return (x == NA_INTEGER) ? NA_REAL : static_cast<double>(x);
+}
+
+// -----------------------------------------------------------------------------
+// Missing values
+//
+// Like `na.rm` in base R, `NaN` counts as missing for doubles.
+
+inline bool rray__is_na(double x) {
+  return ISNAN(x);
+}
+
+inline bool rray__is_na(int x) {
+  return x == NA_INTEGER;
+}
+
+template <typename S>
+inline S rray__na();
+
+template <>
+inline double rray__na<double>() {
+  return NA_REAL;
+}
+
+template <>
+inline int rray__na<int>() {
+  return NA_INTEGER;
+}
+
+static const R_xlen_t rray_no_na_block = 1024;
+
+template <typename S>
+inline bool rray__no_na_impl(const S* p_x, R_xlen_t size) {
+  std::atomic<bool> found(false);
+
+  rray__parallel_for(size, [&](R_xlen_t begin, R_xlen_t end) {
+    for (R_xlen_t start = begin; start < end; start += rray_no_na_block) {
+      if (found.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      const R_xlen_t block_end = std::min(end, start + rray_no_na_block);
+
+      // Branch free, so the compiler can vectorize it
+      int any_na = 0;
+      for (R_xlen_t i = start; i < block_end; ++i) {
+        any_na |= rray__is_na(p_x[i]);
+      }
+
+      if (any_na) {
+        found = true;
+        return;
+      }
+    }
+  });
+
+  return !found;
+}
+
+// Calls `f(p_values, n_values)` on the values of `p_x` that are not
+// missing, compacted into a buffer one block at a time. Returns the number
+// of missing values.
+
+template <typename S, class F>
+inline R_xlen_t rray__for_each_non_na(const S* p_x, R_xlen_t n, F f) {
+  S buffer[rray_no_na_block];
+  R_xlen_t n_na = 0;
+
+  for (R_xlen_t start = 0; start < n; start += rray_no_na_block) {
+    const R_xlen_t block_end = std::min(n, start + rray_no_na_block);
+    R_xlen_t n_values = 0;
+
+    for (R_xlen_t i = start; i < block_end; ++i) {
+      buffer[n_values] = p_x[i];
+      n_values += !rray__is_na(p_x[i]);
+    }
+
+    n_na += (block_end - start) - n_values;
+
+    if (n_values > 0) {
+      f(buffer, n_values);
+    }
+  }
+
+  return n_na;
+}
+
+// Proves that `x` has no missing values, so that `na.rm` can be ignored.
+// ALTREP vectors, such as `1:n`, may already know that they have none, in
+// which case they are not scanned at all.
+//
+// This is the only result that is remembered across calls. Caching the scan
+// on `x` itself, as an attribute, would not be safe: attributes are kept
+// when `x` is modified in place, and copied along with it.
+
+inline bool rray__no_na(SEXP x) {
+  switch (TYPEOF(x)) {
+  case REALSXP: {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+    if (REAL_NO_NA(x)) return true;
+#endif
+    return rray__no_na_impl(REAL(x), Rf_xlength(x));
+  }
+  case INTSXP: {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+    if (INTEGER_NO_NA(x)) return true;
+#endif
+    return rray__no_na_impl(INTEGER(x), Rf_xlength(x));
+  }
+  case LGLSXP: {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+    if (LOGICAL_NO_NA(x)) return true;
+#endif
+    return rray__no_na_impl(LOGICAL(x), Rf_xlength(x));
+  }
+  default: {
+    error_unknown_type();
+  }
+  }
+}
+
+// Whether the `na.rm` code paths are actually needed for `x`
+inline bool rray__needs_na_rm(SEXP x, bool na_rm) {
+  return na_rm && !r_is_null(x) && !rray__no_na(x);
+}
+
+// -----------------------------------------------------------------------------
+// Summation kernels
+
+// Pairwise summation. The error grows with `log(n)` rather than `n`, at
+// nearly the cost of a naive loop: the recursion stops at blocks of
+// `rray_pairwise_block` elements, which are summed with 8 independent
+// accumulators that the compiler can keep in vector registers.
+
+static const R_xlen_t rray_pairwise_block = 128;
+
+template <typename S>
+inline double rray__pairwise_sum(const S* p_x, R_xlen_t n) {
+  if (n <= rray_pairwise_block) {
+    double acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    R_xlen_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+      for (int k = 0; k < 8; ++k) {
+        acc[k] += rray__as_double(p_x[i + k]);
+      }
+    }
+
+    double rest = 0;
+    for (; i < n; ++i) {
+      rest += rray__as_double(p_x[i]);
+    }
+
+    return ((acc[0] + acc[1]) + (acc[2] + acc[3])) +
+      ((acc[4] + acc[5]) + (acc[6] + acc[7])) + rest;
+  }
+
+  // Split on a multiple of 8 so every block but the last is fully unrolled
+  R_xlen_t half = n / 2;
+  half -= half % 8;
+
+  return rray__pairwise_sum(p_x, half) + rray__pairwise_sum(p_x + half, n - half);
+}
+
+// Neumaier's variant of Kahan summation. The rounding error of every
+// addition is accumulated separately in `comp`, and added back at the end.
+
+struct rray_neumaier {
+  double sum;
+  double comp;
+
+  rray_neumaier() : sum(0), comp(0) {}
+
+  inline void add(double x) {
+    const double t = sum + x;
+
+    if (std::fabs(sum) >= std::fabs(x)) {
+      comp += (sum - t) + x;
+    }
+    else {
+      comp += (x - t) + sum;
+    }
+
+    sum = t;
+  }
+
+  // Infinite sums would have a `NaN` compensation
+  inline double value() const {
+    return R_FINITE(sum) ? sum + comp : sum;
+  }
+};
+
+template <typename S>
+inline double rray__compensated_sum(const S* p_x, R_xlen_t n) {
+  rray_neumaier acc;
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    acc.add(rray__as_double(p_x[i]));
+  }
+
+  return acc.value();
+}
+
+#endif
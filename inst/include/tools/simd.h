@@ -0,0 +1,40 @@
+#ifndef rray_simd_h
+#define rray_simd_h
+
+#include <Rcpp.h>
+
+// -----------------------------------------------------------------------------
+// Runtime instruction set dispatch
+//
+// The flat elementwise loops are compiled several times, each for a
+// different x86 instruction set. The best one supported by the CPU the
+// package is loaded on is picked once, in `rray_init_simd()`, so the same
+// binary can be shared between machines. On other platforms or compilers,
+// only the baseline version exists.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RRAY_SIMD_DISPATCH 1
+#define RRAY_TARGET_AVX2 __attribute__((target("avx2")))
+#define RRAY_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#else
+#define RRAY_TARGET_AVX2
+#define RRAY_TARGET_AVX512
+#endif
+
+// Ask gcc to vectorize the loop, even at `-O2`. clang already does so, and
+// warns when it can't honor the request.
+#if defined(_OPENMP) && !defined(__clang__)
+#define RRAY_PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define RRAY_PRAGMA_SIMD
+#endif
+
+enum rray_simd {
+  rray_simd_baseline = 0,
+  rray_simd_avx2 = 1,
+  rray_simd_avx512 = 2
+};
+
+extern rray_simd rray_simd_level;
+
+#endif
@@ -4,5 +4,9 @@
 // Include all relevant tools
 #include <tools/errors.h>
 #include <tools/template-utils.h>
+#include <tools/parallel.h>
+#include <tools/elementwise.h>
+#include <tools/int-overflow.h>
+#include <tools/reduce.h>
 
 #endif
@@ -20,4 +20,8 @@ extern SEXP fns_vec_ptype_inner2;
 
 SEXP r_new_environment(SEXP parent, R_len_t size);
 
+SEXPTYPE rray_native_inner_type(SEXP x);
+
+SEXP rray_shared_empty(SEXPTYPE type);
+
 #endif
@@ -6,6 +6,18 @@
 
 using namespace Rcpp;
 
+// rray__accumulate
+Rcpp::RObject rray__accumulate(Rcpp::RObject x, Rcpp::RObject axis, int op);
+RcppExport SEXP _rray_rray__accumulate(SEXP xSEXP, SEXP axisSEXP, SEXP opSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axis(axisSEXP);
+    Rcpp::traits::input_parameter< int >::type op(opSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__accumulate(x, axis, op));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rray__add
 Rcpp::RObject rray__add(Rcpp::RObject x, Rcpp::RObject y);
 RcppExport SEXP _rray_rray__add(SEXP xSEXP, SEXP ySEXP) {
@@ -81,6 +93,42 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// rray__batch_binary
+Rcpp::List rray__batch_binary(Rcpp::List x, Rcpp::List y, int op, bool is_rray);
+RcppExport SEXP _rray_rray__batch_binary(SEXP xSEXP, SEXP ySEXP, SEXP opSEXP, SEXP is_rraySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type y(ySEXP);
+    Rcpp::traits::input_parameter< int >::type op(opSEXP);
+    Rcpp::traits::input_parameter< bool >::type is_rray(is_rraySEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__batch_binary(x, y, op, is_rray));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__batch_dot
+Rcpp::List rray__batch_dot(Rcpp::List x, Rcpp::List y, bool is_rray);
+RcppExport SEXP _rray_rray__batch_dot(SEXP xSEXP, SEXP ySEXP, SEXP is_rraySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type y(ySEXP);
+    Rcpp::traits::input_parameter< bool >::type is_rray(is_rraySEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__batch_dot(x, y, is_rray));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__batch_dot_stacked
+Rcpp::RObject rray__batch_dot_stacked(Rcpp::RObject x, Rcpp::RObject y);
+RcppExport SEXP _rray_rray__batch_dot_stacked(SEXP xSEXP, SEXP ySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type y(ySEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__batch_dot_stacked(x, y));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rray__bind
 Rcpp::RObject rray__bind(Rcpp::RObject proxy, Rcpp::List args, const int& axis);
 RcppExport SEXP _rray_rray__bind(SEXP proxySEXP, SEXP argsSEXP, SEXP axisSEXP) {
@@ -366,6 +414,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// rray__fuse
+Rcpp::RObject rray__fuse(Rcpp::IntegerVector ops, Rcpp::IntegerVector args, Rcpp::List leaves, Rcpp::IntegerVector dim);
+RcppExport SEXP _rray_rray__fuse(SEXP opsSEXP, SEXP argsSEXP, SEXP leavesSEXP, SEXP dimSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type ops(opsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type args(argsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type leaves(leavesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type dim(dimSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__fuse(ops, args, leaves, dim));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rray__reshape
 Rcpp::RObject rray__reshape(Rcpp::RObject x, const Rcpp::IntegerVector& dim);
 RcppExport SEXP _rray_rray__reshape(SEXP xSEXP, SEXP dimSEXP) {
@@ -453,6 +514,18 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// rray__count
+Rcpp::RObject rray__count(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__count(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__count(x, axes, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rray__if_else
 Rcpp::RObject rray__if_else(Rcpp::RObject condition, Rcpp::RObject true_, Rcpp::RObject false_);
 RcppExport SEXP _rray_rray__if_else(SEXP conditionSEXP, SEXP true_SEXP, SEXP false_SEXP) {
@@ -543,15 +616,22 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// rray__multiply_add
-Rcpp::RObject rray__multiply_add(Rcpp::RObject x, Rcpp::RObject y, Rcpp::RObject z);
-RcppExport SEXP _rray_rray__multiply_add(SEXP xSEXP, SEXP ySEXP, SEXP zSEXP) {
+// rray__set_threads
+int rray__set_threads(int n);
+RcppExport SEXP _rray_rray__set_threads(SEXP nSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
-    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
-    Rcpp::traits::input_parameter< Rcpp::RObject >::type y(ySEXP);
-    Rcpp::traits::input_parameter< Rcpp::RObject >::type z(zSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__multiply_add(x, y, z));
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__set_threads(n));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__threads
+int rray__threads();
+RcppExport SEXP _rray_rray__threads() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    rcpp_result_gen = Rcpp::wrap(rray__threads());
     return rcpp_result_gen;
 END_RCPP
 }
@@ -566,80 +646,224 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
-// rray__max_pos
-Rcpp::RObject rray__max_pos(Rcpp::RObject x, Rcpp::RObject axis);
-RcppExport SEXP _rray_rray__max_pos(SEXP xSEXP, SEXP axisSEXP) {
+// rray__sort_pos
+Rcpp::RObject rray__sort_pos(Rcpp::RObject x, Rcpp::RObject axis, bool decreasing);
+RcppExport SEXP _rray_rray__sort_pos(SEXP xSEXP, SEXP axisSEXP, SEXP decreasingSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
     Rcpp::traits::input_parameter< Rcpp::RObject >::type axis(axisSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__max_pos(x, axis));
+    Rcpp::traits::input_parameter< bool >::type decreasing(decreasingSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__sort_pos(x, axis, decreasing));
     return rcpp_result_gen;
 END_RCPP
 }
-// rray__min_pos
-Rcpp::RObject rray__min_pos(Rcpp::RObject x, Rcpp::RObject axis);
-RcppExport SEXP _rray_rray__min_pos(SEXP xSEXP, SEXP axisSEXP) {
+// rray__top_k
+Rcpp::List rray__top_k(Rcpp::RObject x, double k, Rcpp::RObject axis, bool decreasing);
+RcppExport SEXP _rray_rray__top_k(SEXP xSEXP, SEXP kSEXP, SEXP axisSEXP, SEXP decreasingSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type k(kSEXP);
     Rcpp::traits::input_parameter< Rcpp::RObject >::type axis(axisSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__min_pos(x, axis));
+    Rcpp::traits::input_parameter< bool >::type decreasing(decreasingSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__top_k(x, k, axis, decreasing));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__max_pos
+Rcpp::RObject rray__max_pos(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__max_pos(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__max_pos(x, axes, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__min_pos
+Rcpp::RObject rray__min_pos(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__min_pos(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__min_pos(x, axes, na_rm));
     return rcpp_result_gen;
 END_RCPP
 }
+// rray__reduce_custom
+Rcpp::RObject rray__reduce_custom(Rcpp::RObject x, Rcpp::RObject axes, int op, double threshold, Rcpp::RObject callable, double init, bool na_rm);
+RcppExport SEXP _rray_rray__reduce_custom(SEXP xSEXP, SEXP axesSEXP, SEXP opSEXP, SEXP thresholdSEXP, SEXP callableSEXP, SEXP initSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< int >::type op(opSEXP);
+    Rcpp::traits::input_parameter< double >::type threshold(thresholdSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type callable(callableSEXP);
+    Rcpp::traits::input_parameter< double >::type init(initSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__reduce_custom(x, axes, op, threshold, callable, init, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__test_register_callable
+void rray__test_register_callable();
+RcppExport SEXP _rray_rray__test_register_callable() {
+BEGIN_RCPP
+    rray__test_register_callable();
+    return R_NilValue;
+END_RCPP
+}
 // rray__sum
-Rcpp::RObject rray__sum(Rcpp::RObject x, Rcpp::RObject axes);
-RcppExport SEXP _rray_rray__sum(SEXP xSEXP, SEXP axesSEXP) {
+Rcpp::RObject rray__sum(Rcpp::RObject x, Rcpp::RObject axes, bool compensated, bool na_rm);
+RcppExport SEXP _rray_rray__sum(SEXP xSEXP, SEXP axesSEXP, SEXP compensatedSEXP, SEXP na_rmSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
     Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__sum(x, axes));
+    Rcpp::traits::input_parameter< bool >::type compensated(compensatedSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__sum(x, axes, compensated, na_rm));
     return rcpp_result_gen;
 END_RCPP
 }
 // rray__prod
-Rcpp::RObject rray__prod(Rcpp::RObject x, Rcpp::RObject axes);
-RcppExport SEXP _rray_rray__prod(SEXP xSEXP, SEXP axesSEXP) {
+Rcpp::RObject rray__prod(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__prod(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
     Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__prod(x, axes));
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__prod(x, axes, na_rm));
     return rcpp_result_gen;
 END_RCPP
 }
 // rray__mean
-Rcpp::RObject rray__mean(Rcpp::RObject x, Rcpp::RObject axes);
-RcppExport SEXP _rray_rray__mean(SEXP xSEXP, SEXP axesSEXP) {
+Rcpp::RObject rray__mean(Rcpp::RObject x, Rcpp::RObject axes, bool compensated, bool na_rm);
+RcppExport SEXP _rray_rray__mean(SEXP xSEXP, SEXP axesSEXP, SEXP compensatedSEXP, SEXP na_rmSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
     Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__mean(x, axes));
+    Rcpp::traits::input_parameter< bool >::type compensated(compensatedSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__mean(x, axes, compensated, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__var
+Rcpp::RObject rray__var(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__var(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__var(x, axes, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__sd
+Rcpp::RObject rray__sd(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__sd(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__sd(x, axes, na_rm));
     return rcpp_result_gen;
 END_RCPP
 }
 // rray__max
-Rcpp::RObject rray__max(Rcpp::RObject x, Rcpp::Nullable<Rcpp::IntegerVector> axes);
-RcppExport SEXP _rray_rray__max(SEXP xSEXP, SEXP axesSEXP) {
+Rcpp::RObject rray__max(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__max(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
-    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::IntegerVector> >::type axes(axesSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__max(x, axes));
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__max(x, axes, na_rm));
     return rcpp_result_gen;
 END_RCPP
 }
 // rray__min
-Rcpp::RObject rray__min(Rcpp::RObject x, Rcpp::Nullable<Rcpp::IntegerVector> axes);
-RcppExport SEXP _rray_rray__min(SEXP xSEXP, SEXP axesSEXP) {
+Rcpp::RObject rray__min(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm);
+RcppExport SEXP _rray_rray__min(SEXP xSEXP, SEXP axesSEXP, SEXP na_rmSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
-    Rcpp::traits::input_parameter< Rcpp::Nullable<Rcpp::IntegerVector> >::type axes(axesSEXP);
-    rcpp_result_gen = Rcpp::wrap(rray__min(x, axes));
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__min(x, axes, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__summarise
+Rcpp::List rray__summarise(Rcpp::RObject x, Rcpp::RObject axes, Rcpp::CharacterVector stats, bool na_rm);
+RcppExport SEXP _rray_rray__summarise(SEXP xSEXP, SEXP axesSEXP, SEXP statsSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type stats(statsSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__summarise(x, axes, stats, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__quantile
+Rcpp::RObject rray__quantile(Rcpp::RObject x, Rcpp::RObject axes, std::vector<double> probs, bool probs_axis, bool na_rm);
+RcppExport SEXP _rray_rray__quantile(SEXP xSEXP, SEXP axesSEXP, SEXP probsSEXP, SEXP probs_axisSEXP, SEXP na_rmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type axes(axesSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type probs(probsSEXP);
+    Rcpp::traits::input_parameter< bool >::type probs_axis(probs_axisSEXP);
+    Rcpp::traits::input_parameter< bool >::type na_rm(na_rmSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__quantile(x, axes, probs, probs_axis, na_rm));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__roll
+Rcpp::RObject rray__roll(Rcpp::RObject x, double width, int axis, int op);
+RcppExport SEXP _rray_rray__roll(SEXP xSEXP, SEXP widthSEXP, SEXP axisSEXP, SEXP opSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< double >::type width(widthSEXP);
+    Rcpp::traits::input_parameter< int >::type axis(axisSEXP);
+    Rcpp::traits::input_parameter< int >::type op(opSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__roll(x, width, axis, op));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__search_sorted
+Rcpp::RObject rray__search_sorted(Rcpp::RObject sorted, Rcpp::RObject values, int axis, bool right);
+RcppExport SEXP _rray_rray__search_sorted(SEXP sortedSEXP, SEXP valuesSEXP, SEXP axisSEXP, SEXP rightSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type sorted(sortedSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type values(valuesSEXP);
+    Rcpp::traits::input_parameter< int >::type axis(axisSEXP);
+    Rcpp::traits::input_parameter< bool >::type right(rightSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__search_sorted(sorted, values, axis, right));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rray__simd
+std::string rray__simd();
+RcppExport SEXP _rray_rray__simd() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    rcpp_result_gen = Rcpp::wrap(rray__simd());
     return rcpp_result_gen;
 END_RCPP
 }
@@ -697,6 +921,20 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// rray__ternary
+Rcpp::RObject rray__ternary(Rcpp::RObject x, Rcpp::RObject y, Rcpp::RObject z, int op, bool as_double);
+RcppExport SEXP _rray_rray__ternary(SEXP xSEXP, SEXP ySEXP, SEXP zSEXP, SEXP opSEXP, SEXP as_doubleSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type x(xSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type y(ySEXP);
+    Rcpp::traits::input_parameter< Rcpp::RObject >::type z(zSEXP);
+    Rcpp::traits::input_parameter< int >::type op(opSEXP);
+    Rcpp::traits::input_parameter< bool >::type as_double(as_doubleSEXP);
+    rcpp_result_gen = Rcpp::wrap(rray__ternary(x, y, z, op, as_double));
+    return rcpp_result_gen;
+END_RCPP
+}
 // rray__validate_dim
 void rray__validate_dim(Rcpp::IntegerVector dim);
 RcppExport SEXP _rray_rray__validate_dim(SEXP dimSEXP) {
@@ -751,6 +989,7 @@ END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_rray_rray__accumulate", (DL_FUNC) &_rray_rray__accumulate, 3},
     {"_rray_rray__add", (DL_FUNC) &_rray_rray__add, 2},
     {"_rray_rray__subtract", (DL_FUNC) &_rray_rray__subtract, 2},
     {"_rray_rray__divide", (DL_FUNC) &_rray_rray__divide, 2},
@@ -758,6 +997,9 @@ static const R_CallMethodDef CallEntries[] = {
     {"_rray_rray__pow", (DL_FUNC) &_rray_rray__pow, 2},
     {"_rray_rray__identity", (DL_FUNC) &_rray_rray__identity, 1},
     {"_rray_rray__opposite", (DL_FUNC) &_rray_rray__opposite, 1},
+    {"_rray_rray__batch_binary", (DL_FUNC) &_rray_rray__batch_binary, 4},
+    {"_rray_rray__batch_dot", (DL_FUNC) &_rray_rray__batch_dot, 3},
+    {"_rray_rray__batch_dot_stacked", (DL_FUNC) &_rray_rray__batch_dot_stacked, 2},
     {"_rray_rray__bind", (DL_FUNC) &_rray_rray__bind, 3},
     {"_rray_rray__broadcast", (DL_FUNC) &_rray_rray__broadcast, 2},
     {"_rray_rray__full_like", (DL_FUNC) &_rray_rray__full_like, 2},
@@ -784,6 +1026,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_rray_rray__extract", (DL_FUNC) &_rray_rray__extract, 2},
     {"_rray_rray__maximum", (DL_FUNC) &_rray_rray__maximum, 2},
     {"_rray_rray__minimum", (DL_FUNC) &_rray_rray__minimum, 2},
+    {"_rray_rray__fuse", (DL_FUNC) &_rray_rray__fuse, 4},
     {"_rray_rray__reshape", (DL_FUNC) &_rray_rray__reshape, 2},
     {"_rray_rray__hypot", (DL_FUNC) &_rray_rray__hypot, 2},
     {"_rray_rray_init", (DL_FUNC) &_rray_rray_init, 1},
@@ -792,6 +1035,7 @@ static const R_CallMethodDef CallEntries[] = {
     {"_rray_rray__logical_not", (DL_FUNC) &_rray_rray__logical_not, 1},
     {"_rray_rray__any", (DL_FUNC) &_rray_rray__any, 2},
     {"_rray_rray__all", (DL_FUNC) &_rray_rray__all, 2},
+    {"_rray_rray__count", (DL_FUNC) &_rray_rray__count, 3},
     {"_rray_rray__if_else", (DL_FUNC) &_rray_rray__if_else, 3},
     {"_rray_rray__split", (DL_FUNC) &_rray_rray__split, 2},
     {"_rray_rray__rotate", (DL_FUNC) &_rray_rray__rotate, 4},
@@ -800,20 +1044,33 @@ static const R_CallMethodDef CallEntries[] = {
     {"_rray_rray__expand", (DL_FUNC) &_rray_rray__expand, 2},
     {"_rray_rray__flip", (DL_FUNC) &_rray_rray__flip, 2},
     {"_rray_rray__flatten", (DL_FUNC) &_rray_rray__flatten, 1},
-    {"_rray_rray__multiply_add", (DL_FUNC) &_rray_rray__multiply_add, 3},
+    {"_rray_rray__set_threads", (DL_FUNC) &_rray_rray__set_threads, 1},
+    {"_rray_rray__threads", (DL_FUNC) &_rray_rray__threads, 0},
     {"_rray_rray__sort", (DL_FUNC) &_rray_rray__sort, 2},
-    {"_rray_rray__max_pos", (DL_FUNC) &_rray_rray__max_pos, 2},
-    {"_rray_rray__min_pos", (DL_FUNC) &_rray_rray__min_pos, 2},
-    {"_rray_rray__sum", (DL_FUNC) &_rray_rray__sum, 2},
-    {"_rray_rray__prod", (DL_FUNC) &_rray_rray__prod, 2},
-    {"_rray_rray__mean", (DL_FUNC) &_rray_rray__mean, 2},
-    {"_rray_rray__max", (DL_FUNC) &_rray_rray__max, 2},
-    {"_rray_rray__min", (DL_FUNC) &_rray_rray__min, 2},
+    {"_rray_rray__sort_pos", (DL_FUNC) &_rray_rray__sort_pos, 3},
+    {"_rray_rray__top_k", (DL_FUNC) &_rray_rray__top_k, 4},
+    {"_rray_rray__max_pos", (DL_FUNC) &_rray_rray__max_pos, 3},
+    {"_rray_rray__min_pos", (DL_FUNC) &_rray_rray__min_pos, 3},
+    {"_rray_rray__reduce_custom", (DL_FUNC) &_rray_rray__reduce_custom, 7},
+    {"_rray_rray__test_register_callable", (DL_FUNC) &_rray_rray__test_register_callable, 0},
+    {"_rray_rray__sum", (DL_FUNC) &_rray_rray__sum, 4},
+    {"_rray_rray__prod", (DL_FUNC) &_rray_rray__prod, 3},
+    {"_rray_rray__mean", (DL_FUNC) &_rray_rray__mean, 4},
+    {"_rray_rray__var", (DL_FUNC) &_rray_rray__var, 3},
+    {"_rray_rray__sd", (DL_FUNC) &_rray_rray__sd, 3},
+    {"_rray_rray__max", (DL_FUNC) &_rray_rray__max, 3},
+    {"_rray_rray__min", (DL_FUNC) &_rray_rray__min, 3},
+    {"_rray_rray__summarise", (DL_FUNC) &_rray_rray__summarise, 4},
+    {"_rray_rray__quantile", (DL_FUNC) &_rray_rray__quantile, 5},
+    {"_rray_rray__roll", (DL_FUNC) &_rray_rray__roll, 4},
+    {"_rray_rray__search_sorted", (DL_FUNC) &_rray_rray__search_sorted, 4},
+    {"_rray_rray__simd", (DL_FUNC) &_rray_rray__simd, 0},
     {"_rray_rray__subset_assign", (DL_FUNC) &_rray_rray__subset_assign, 3},
     {"_rray_is_any_na_int", (DL_FUNC) &_rray_is_any_na_int, 1},
     {"_rray_is_contiguous_increasing", (DL_FUNC) &_rray_is_contiguous_increasing, 1},
     {"_rray_subset_dim_names", (DL_FUNC) &_rray_subset_dim_names, 2},
     {"_rray_rray__subset", (DL_FUNC) &_rray_rray__subset, 2},
+    {"_rray_rray__ternary", (DL_FUNC) &_rray_rray__ternary, 5},
     {"_rray_rray__validate_dim", (DL_FUNC) &_rray_rray__validate_dim, 1},
     {"_rray_rray__validate_reshape", (DL_FUNC) &_rray_rray__validate_reshape, 2},
     {"_rray_rray__validate_broadcastable_to_dim", (DL_FUNC) &_rray_rray__validate_broadcastable_to_dim, 2},
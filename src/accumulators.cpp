@@ -1,65 +1,231 @@
 #include <rray.h>
 #include <dispatch.h>
+#include <tools/tools.h>
 
-// Both required for cumsum() / cumprod()
-#include <xtensor/xarray.hpp>
-#include <xtensor/xview.hpp>
+// -----------------------------------------------------------------------------
+// Cumulative accumulators
+//
+// With `axis`, `x` is seen as `outer` slabs of `n` rows of `inner`
+// contiguous elements, where `n` is the size of `axis`. Every row is
+// accumulated elementwise into the previous row of the result, so memory is
+// only ever walked forwards and the inner loop is contiguous. Without
+// `axis`, `x` is accumulated in column major order, as a single lane.
+//
+// Independent lanes are split across threads, by slabs when there are
+// enough of them or when the rows are too narrow, otherwise by columns
+// within the rows.
+//
+// Like base R, a missing value makes the rest of its lane missing, and
+// integer sums that overflow become `NA` with a warning.
+
+// Keep in sync with `accumulate_ops` in R/accumulators.R
+enum accumulate_op {
+  accumulate_sum = 0,
+  accumulate_prod = 1,
+  accumulate_max = 2,
+  accumulate_min = 3
+};
 
 // -----------------------------------------------------------------------------
 
-// BLOCKED until
-// https://github.com/QuantStack/xtensor/issues/1334
+template <typename R>
+struct accumulate_sum_fn;
 
-// TODO - detect integer overflow, maybe have to write a custom accumulator?
-// https://github.com/wch/r-source/blob/5a156a0865362bb8381dcd69ac335f5174a4f60c/src/main/cum.c#L40
-// https://github.com/QuantStack/xtensor/blob/94931618b695dbbae9155637dd7a43c8e64121f4/include/xtensor/xmath.hpp#L2042
+template <>
+struct accumulate_sum_fn<double> {
+  inline double operator()(double acc, double x, std::atomic<bool>& overflow) const {
+    return acc + x;
+  }
+};
 
-// TODO - convert logicals to integers
+template <>
+struct accumulate_sum_fn<int> {
+  inline int operator()(int acc, int x, std::atomic<bool>& overflow) const {
+    const bool any_na = (acc == NA_INTEGER) || (x == NA_INTEGER);
+    return rray__int_checked(static_cast<int64_t>(acc) + x, any_na, overflow);
+  }
+};
 
-// To prevent overflow, return doubles
+struct accumulate_prod_fn {
+  inline double operator()(double acc, double x, std::atomic<bool>& overflow) const {
+    return acc * x;
+  }
+};
 
-// template <typename T>
-// xt::rarray<double> rray__cumsum_impl(const xt::rarray<T>& x,
-//                                      Rcpp::RObject axis) {
-//
-//   if (r_is_null(axis)) {
-//     xt::rarray<double> res = xt::cumsum(x);
-//     return res;
-//   }
-//
-//   std::ptrdiff_t xt_axis = Rcpp::as<std::ptrdiff_t>(axis);
-//   xt::rarray<double> res = xt::cumsum(x, xt_axis);
-//
-//   return res;
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// Rcpp::RObject rray__cumsum(Rcpp::RObject x, Rcpp::RObject axis) {
-//   DISPATCH_UNARY_ONE(rray__cumsum_impl, x, axis);
-// }
+// The first missing value of a lane is carried along, like `cummax()`
+template <typename R, bool is_max>
+struct accumulate_extreme_fn {
+  inline R operator()(R acc, R x, std::atomic<bool>& overflow) const {
+    if (rray__is_na(acc)) {
+      return acc;
+    }
+
+    if (rray__is_na(x)) {
+      return x;
+    }
+
+    return is_max ? std::max(acc, x) : std::min(acc, x);
+  }
+};
 
 // -----------------------------------------------------------------------------
 
-// BLOCKED until
-// https://github.com/QuantStack/xtensor/issues/1334
+template <typename R>
+inline R accumulate_convert(int x);
 
-// template <typename T>
-// xt::rarray<T> rray__cumprod_impl(const xt::rarray<T>& x,
-//                                  Rcpp::RObject axis) {
-//
-//   if (r_is_null(axis)) {
-//     xt::rarray<double> res = xt::cumprod(x);
-//     return res;
-//   }
-//
-//   std::ptrdiff_t xt_axis = Rcpp::as<std::ptrdiff_t>(axis);
-//   xt::rarray<double> res = xt::cumprod(x, xt_axis);
-//   return res;
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// Rcpp::RObject rray__cumprod(Rcpp::RObject x, Rcpp::RObject axis) {
-//   DISPATCH_UNARY_ONE(rray__cumprod_impl, x, axis);
-// }
+template <>
+inline double accumulate_convert<double>(int x) {
+  return rray__as_double(x);
+}
 
-// -----------------------------------------------------------------------------
+template <>
+inline int accumulate_convert<int>(int x) {
+  return x;
+}
+
+template <typename R>
+inline R accumulate_convert(double x) {
+  return static_cast<R>(x);
+}
+
+template <typename R, typename S, class F>
+void rray__accumulate_loop(const S* p_x,
+                           R* p_out,
+                           R_xlen_t inner,
+                           R_xlen_t n,
+                           R_xlen_t outer,
+                           F fn,
+                           std::atomic<bool>& overflow) {
+
+  const R_xlen_t size = inner * n * outer;
+  int n_threads = rray__threads_for(size);
+
+  // Rows too narrow to give every thread some columns are split by slabs,
+  // with at most one thread per slab
+  const bool split_outer = outer >= n_threads || inner < n_threads;
+
+  if (split_outer) {
+    n_threads = std::min<R_xlen_t>(n_threads, outer);
+  }
+
+  if (n == 0 || n_threads == 0) {
+    return;
+  }
+
+  rray__parallel_each(n_threads, [&](int thread) {
+    R_xlen_t outer_begin = 0;
+    R_xlen_t outer_end = outer;
+    R_xlen_t inner_begin = 0;
+    R_xlen_t inner_end = inner;
+
+    if (split_outer) {
+      outer_begin = outer * thread / n_threads;
+      outer_end = outer * (thread + 1) / n_threads;
+    }
+    else {
+      inner_begin = inner * thread / n_threads;
+      inner_end = inner * (thread + 1) / n_threads;
+    }
+
+    for (R_xlen_t o = outer_begin; o < outer_end; ++o) {
+      const R_xlen_t slab = o * inner * n;
+
+      // The first row starts every lane
+      for (R_xlen_t i = inner_begin; i < inner_end; ++i) {
+        p_out[slab + i] = accumulate_convert<R>(p_x[slab + i]);
+      }
+
+      for (R_xlen_t k = 1; k < n; ++k) {
+        const R_xlen_t row = slab + k * inner;
+        const R* p_prev = p_out + row - inner;
+
+        for (R_xlen_t i = inner_begin; i < inner_end; ++i) {
+          p_out[row + i] = fn(p_prev[i], accumulate_convert<R>(p_x[row + i]), overflow);
+        }
+      }
+    }
+  });
+}
+
+template <typename T>
+Rcpp::RObject rray__accumulate_impl(const xt::rarray<T>& x,
+                                    Rcpp::RObject axis,
+                                    int op) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  const R_xlen_t size = rray__dim_size(dim);
+
+  R_xlen_t inner = 1;
+  R_xlen_t n = size;
+  R_xlen_t outer = 1;
+
+  if (!r_is_null(axis)) {
+    const int int_axis = Rcpp::as<int>(axis);
+
+    for (int i = 0; i < int_axis; ++i) {
+      inner *= dim[i];
+    }
+
+    n = dim[int_axis];
+
+    for (int i = int_axis + 1; i < dim.size(); ++i) {
+      outer *= dim[i];
+    }
+  }
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  // Products are always doubles, like `cumprod()`. Otherwise, logicals
+  // are accumulated as integers.
+  const bool is_double = std::is_same<T, double>::value || op == accumulate_prod;
+
+  Rcpp::RObject out = Rf_allocVector(is_double ? REALSXP : INTSXP, size);
+  out.attr("dim") = dim;
+
+  std::atomic<bool> overflow(false);
+
+  if (is_double) {
+    double* p_out = REAL(out);
+
+    switch (op) {
+    case accumulate_sum: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_sum_fn<double>(), overflow); break;
+    case accumulate_prod: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_prod_fn(), overflow); break;
+    case accumulate_max: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_extreme_fn<double, true>(), overflow); break;
+    case accumulate_min: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_extreme_fn<double, false>(), overflow); break;
+    }
+  }
+  else {
+    int* p_out = INTEGER(out);
+
+    switch (op) {
+    case accumulate_sum: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_sum_fn<int>(), overflow); break;
+    case accumulate_max: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_extreme_fn<int, true>(), overflow); break;
+    case accumulate_min: rray__accumulate_loop(p_x, p_out, inner, n, outer, accumulate_extreme_fn<int, false>(), overflow); break;
+    }
+  }
+
+  rray__warn_int_overflow(overflow);
+
+  return out;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__accumulate(Rcpp::RObject x, Rcpp::RObject axis, int op) {
+
+  if (op < accumulate_sum || op > accumulate_min) {
+    Rcpp::stop("Internal error: Unknown accumulator %i.", op);
+  }
+
+  if (r_is_null(x)) {
+    return x;
+  }
+
+  Rcpp::RObject out;
+  out = rray__dispatch_unary(RRAY_LIFT(rray__accumulate_impl), x, axis, op);
+
+  rray__resize_and_set_dim_names(out, x);
+
+  return out;
+}
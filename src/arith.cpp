@@ -3,33 +3,103 @@
 #include <cast.h>
 #include <type2.h>
 #include <utils.h>
+#include <kernels.h>
 
 // -----------------------------------------------------------------------------
 
-template <typename T>
-Rcpp::RObject rray__add_impl(const xt::rarray<T>& x,
-                             const xt::rarray<T>& y) {
+// `x` can be reused to hold the result when it was just allocated by
+// `vec__cast_inner()` from `x_arg`, and it already has the type and
+// dimensions of the result. Only then is it known to be owned by this call.
+// Reference counts can't tell, as `x_arg` may be bound to a single variable
+// of the caller, and the protection by Rcpp counts as a reference too.
+// Classed objects are never reused, as their attributes would leak into
+// the result.
+
+bool rray__is_reusable(SEXP x, SEXP x_arg, SEXP y) {
+
+  if (x == x_arg) {
+    return false;
+  }
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
+  const int& x_type = TYPEOF(x);
 
-  xt::rarray<T> res = x_view + y_view;
+  if (x_type != INTSXP && x_type != REALSXP) {
+    return false;
+  }
 
-  return Rcpp::as<Rcpp::RObject>(res);
+  if (MAYBE_SHARED(x) || OBJECT(x)) {
+    return false;
+  }
+
+  if (!rray__has_dim(x)) {
+    return false;
+  }
+
+  Rcpp::IntegerVector x_dim = rray__dim(x);
+  Rcpp::IntegerVector dim = rray__dim2(x_dim, rray__dim(y));
+
+  if (x_dim.size() != dim.size()) {
+    return false;
+  }
+
+  return std::equal(x_dim.begin(), x_dim.end(), dim.begin());
 }
 
-// Logicals return integers
-Rcpp::RObject rray__add_impl(const xt::rarray<rlogical>& x,
-                             const xt::rarray<rlogical>& y) {
+// -----------------------------------------------------------------------------
+
+// Integer arithmetic is checked for overflow, and propagates missing values,
+// see `rray__int_checked()`. There is no xtensor equivalent, so the strided
+// loops are always used.
+
+template <typename T, class F>
+Rcpp::RObject rray__arith_int(const xt::rarray<T>& x,
+                              const xt::rarray<T>& y,
+                              bool in_place,
+                              F op) {
+
+  std::atomic<bool> overflow(false);
+
+  Rcpp::RObject out = rray__elementwise2<int>(
+    x, y, in_place,
+    [&overflow, op](int a, int b) {
+      bool any_na = (a == NA_INTEGER) || (b == NA_INTEGER);
+      return rray__int_checked(op(a, b), any_na, overflow);
+    },
+    rray_no_xtensor()
+  );
+
+  rray__warn_int_overflow(overflow);
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
+template <typename T>
+Rcpp::RObject rray__add_impl(const xt::rarray<T>& x,
+                             const xt::rarray<T>& y,
+                             bool in_place = false) {
+
+  return rray__elementwise2<T>(
+    x, y, in_place,
+    [](auto a, auto b) { return a + b; },
+    [](auto& x_view, auto& y_view) { return x_view + y_view; }
+  );
+}
 
-  xt::rarray<int> res = x_view + y_view;
+Rcpp::RObject rray__add_impl(const xt::rarray<int>& x,
+                             const xt::rarray<int>& y,
+                             bool in_place = false) {
 
-  return Rcpp::as<Rcpp::RObject>(res);
+  return rray__arith_int(x, y, in_place, [](int64_t a, int64_t b) { return a + b; });
+}
+
+// Logicals return integers, so `x` is never reused
+Rcpp::RObject rray__add_impl(const xt::rarray<rlogical>& x,
+                             const xt::rarray<rlogical>& y,
+                             bool in_place = false) {
+
+  return rray__arith_int(x, y, false, [](int64_t a, int64_t b) { return a + b; });
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -46,11 +116,14 @@ Rcpp::RObject rray__add(Rcpp::RObject x, Rcpp::RObject y) {
   Rcpp::List new_dim_names = rray__dim_names2(x, y);
 
   Rcpp::RObject type = vec__ptype_inner2(x, y);
+  Rcpp::RObject x_arg = x;
   x = vec__cast_inner(x, type);
   y = vec__cast_inner(y, type);
 
+  bool in_place = rray__is_reusable(x, x_arg, y);
+
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__add_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__add_impl), x, y, in_place);
 
   out.attr("dimnames") = new_dim_names;
 
@@ -61,28 +134,29 @@ Rcpp::RObject rray__add(Rcpp::RObject x, Rcpp::RObject y) {
 
 template <typename T>
 Rcpp::RObject rray__subtract_impl(const xt::rarray<T>& x,
-                                  const xt::rarray<T>& y) {
-
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
+                                  const xt::rarray<T>& y,
+                                  bool in_place = false) {
+
+  return rray__elementwise2<T>(
+    x, y, in_place,
+    [](auto a, auto b) { return a - b; },
+    [](auto& x_view, auto& y_view) { return x_view - y_view; }
+  );
+}
 
-  xt::rarray<T> res = x_view - y_view;
+Rcpp::RObject rray__subtract_impl(const xt::rarray<int>& x,
+                                  const xt::rarray<int>& y,
+                                  bool in_place = false) {
 
-  return Rcpp::as<Rcpp::RObject>(res);
+  return rray__arith_int(x, y, in_place, [](int64_t a, int64_t b) { return a - b; });
 }
 
-// Logicals return integers
+// Logicals return integers, so `x` is never reused
 Rcpp::RObject rray__subtract_impl(const xt::rarray<rlogical>& x,
-                                  const xt::rarray<rlogical>& y) {
+                                  const xt::rarray<rlogical>& y,
+                                  bool in_place = false) {
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  xt::rarray<int> res = x_view - y_view;
-
-  return Rcpp::as<Rcpp::RObject>(res);
+  return rray__arith_int(x, y, false, [](int64_t a, int64_t b) { return a - b; });
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -99,11 +173,14 @@ Rcpp::RObject rray__subtract(Rcpp::RObject x, Rcpp::RObject y) {
   Rcpp::List new_dim_names = rray__dim_names2(x, y);
 
   Rcpp::RObject type = vec__ptype_inner2(x, y);
+  Rcpp::RObject x_arg = x;
   x = vec__cast_inner(x, type);
   y = vec__cast_inner(y, type);
 
+  bool in_place = rray__is_reusable(x, x_arg, y);
+
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__subtract_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__subtract_impl), x, y, in_place);
 
   out.attr("dimnames") = new_dim_names;
 
@@ -115,15 +192,14 @@ Rcpp::RObject rray__subtract(Rcpp::RObject x, Rcpp::RObject y) {
 // Should always take and return a numeric result
 
 Rcpp::RObject rray__divide_impl(const xt::rarray<double>& x,
-                                const xt::rarray<double>& y) {
-
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  xt::rarray<double> res = x_view / y_view;
-
-  return Rcpp::as<Rcpp::RObject>(res);
+                                const xt::rarray<double>& y,
+                                bool in_place = false) {
+
+  return rray__elementwise2<double>(
+    x, y, in_place,
+    [](auto a, auto b) { return a / b; },
+    [](auto& x_view, auto& y_view) { return x_view / y_view; }
+  );
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -139,11 +215,14 @@ Rcpp::RObject rray__divide(Rcpp::RObject x, Rcpp::RObject y) {
 
   Rcpp::List new_dim_names = rray__dim_names2(x, y);
 
+  Rcpp::RObject x_arg = x;
   x = vec__cast_inner(x, rray_shared_empty_dbl);
   y = vec__cast_inner(y, rray_shared_empty_dbl);
 
+  bool in_place = rray__is_reusable(x, x_arg, y);
+
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__divide_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__divide_impl), x, y, in_place);
 
   out.attr("dimnames") = new_dim_names;
 
@@ -154,28 +233,29 @@ Rcpp::RObject rray__divide(Rcpp::RObject x, Rcpp::RObject y) {
 
 template <typename T>
 Rcpp::RObject rray__multiply_impl(const xt::rarray<T>& x,
-                                  const xt::rarray<T>& y) {
-
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
+                                  const xt::rarray<T>& y,
+                                  bool in_place = false) {
+
+  return rray__elementwise2<T>(
+    x, y, in_place,
+    [](auto a, auto b) { return a * b; },
+    [](auto& x_view, auto& y_view) { return x_view * y_view; }
+  );
+}
 
-  xt::rarray<T> res = x_view * y_view;
+Rcpp::RObject rray__multiply_impl(const xt::rarray<int>& x,
+                                  const xt::rarray<int>& y,
+                                  bool in_place = false) {
 
-  return Rcpp::as<Rcpp::RObject>(res);
+  return rray__arith_int(x, y, in_place, [](int64_t a, int64_t b) { return a * b; });
 }
 
-// Logicals return integers
+// Logicals return integers, so `x` is never reused
 Rcpp::RObject rray__multiply_impl(const xt::rarray<rlogical>& x,
-                                  const xt::rarray<rlogical>& y) {
-
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  xt::rarray<int> res = x_view * y_view;
+                                  const xt::rarray<rlogical>& y,
+                                  bool in_place = false) {
 
-  return Rcpp::as<Rcpp::RObject>(res);
+  return rray__arith_int(x, y, false, [](int64_t a, int64_t b) { return a * b; });
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -192,11 +272,14 @@ Rcpp::RObject rray__multiply(Rcpp::RObject x, Rcpp::RObject y) {
   Rcpp::List new_dim_names = rray__dim_names2(x, y);
 
   Rcpp::RObject type = vec__ptype_inner2(x, y);
+  Rcpp::RObject x_arg = x;
   x = vec__cast_inner(x, type);
   y = vec__cast_inner(y, type);
 
+  bool in_place = rray__is_reusable(x, x_arg, y);
+
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__multiply_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__multiply_impl), x, y, in_place);
 
   out.attr("dimnames") = new_dim_names;
 
@@ -208,15 +291,14 @@ Rcpp::RObject rray__multiply(Rcpp::RObject x, Rcpp::RObject y) {
 // On the R side, there is a guarantee that both inputs are double.
 
 Rcpp::RObject rray__pow_impl(const xt::rarray<double>& x,
-                             const xt::rarray<double>& y) {
-
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  xt::rarray<double> res = xt::pow(x_view, y_view);
-
-  return Rcpp::as<Rcpp::RObject>(res);
+                             const xt::rarray<double>& y,
+                             bool in_place = false) {
+
+  return rray__elementwise2<double>(
+    x, y, in_place,
+    [](double a, double b) { return std::pow(a, b); },
+    [](auto& x_view, auto& y_view) { return xt::pow(x_view, y_view); }
+  );
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -232,11 +314,14 @@ Rcpp::RObject rray__pow(Rcpp::RObject x, Rcpp::RObject y) {
 
   Rcpp::List new_dim_names = rray__dim_names2(x, y);
 
+  Rcpp::RObject x_arg = x;
   x = vec__cast_inner(x, rray_shared_empty_dbl);
   y = vec__cast_inner(y, rray_shared_empty_dbl);
 
+  bool in_place = rray__is_reusable(x, x_arg, y);
+
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__pow_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__pow_impl), x, y, in_place);
 
   out.attr("dimnames") = new_dim_names;
 
@@ -290,9 +375,23 @@ Rcpp::RObject rray__opposite_impl(const xt::rarray<rlogical>& x) {
 Rcpp::RObject rray__opposite(Rcpp::RObject x) {
 
   Rcpp::RObject out;
-  DISPATCH_UNARY(out, rray__opposite_impl, x);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__opposite_impl), x);
 
   out.attr("dimnames") = rray__dim_names(x);
 
   return out;
 }
+
+// -----------------------------------------------------------------------------
+
+const rray_binary_kernels rray_add_kernels = RRAY_BINARY_KERNELS(rray__add_impl);
+const rray_binary_kernels rray_subtract_kernels = RRAY_BINARY_KERNELS(rray__subtract_impl);
+const rray_binary_kernels rray_multiply_kernels = RRAY_BINARY_KERNELS(rray__multiply_impl);
+
+const rray_binary_kernels rray_divide_kernels = {
+  RRAY_BINARY_KERNEL(rray__divide_impl, double), NULL, NULL
+};
+
+const rray_binary_kernels rray_pow_kernels = {
+  RRAY_BINARY_KERNEL(rray__pow_impl, double), NULL, NULL
+};
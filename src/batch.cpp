@@ -0,0 +1,276 @@
+#include <rray.h>
+#include <dispatch.h>
+#include <kernels.h>
+#include <cast.h>
+#include <utils.h>
+
+// -----------------------------------------------------------------------------
+// Batched operations
+//
+// A batch is a list of arrays that all share the same dimensions. Rather than
+// computing each element separately, the elements are stacked along a new
+// trailing axis, the operation is computed once on the stacked arrays, and
+// the result is split back into a list. Dimension names and classes are
+// computed once per batch.
+
+// Common inner type of every element of `x` and `y`
+static SEXPTYPE rray__batch_type(const Rcpp::List& x, const Rcpp::List& y) {
+  SEXPTYPE type = LGLSXP;
+
+  for (R_xlen_t i = 0; i < x.size(); ++i) {
+    SEXPTYPE x_type = rray_native_inner_type(x[i]);
+    SEXPTYPE y_type = rray_native_inner_type(y[i]);
+
+    if (x_type == NILSXP || y_type == NILSXP) {
+      Rcpp::stop("Batch elements must be logicals, integers or doubles.");
+    }
+
+    type = std::max(type, std::max(x_type, y_type));
+  }
+
+  return type;
+}
+
+template <typename T>
+static void rray__batch_copy_into(SEXP out, SEXP x, R_xlen_t offset) {
+  const auto* p_x = rray_storage<T>::ptr(x);
+  auto* p_out = rray_storage<T>::ptr(out);
+
+  std::copy(p_x, p_x + Rf_xlength(x), p_out + offset);
+}
+
+template <typename T>
+static void rray__batch_copy_from(SEXP out, SEXP x, R_xlen_t offset) {
+  const auto* p_x = rray_storage<T>::ptr(x);
+  auto* p_out = rray_storage<T>::ptr(out);
+
+  std::copy(p_x + offset, p_x + offset + Rf_xlength(out), p_out);
+}
+
+// Stack the elements of `x` along a new trailing axis. They must all have
+// the dimensions `x_dim`, and are given the dimensionality of `dim_n`.
+
+static Rcpp::RObject rray__batch_stack(const Rcpp::List& x,
+                                       const Rcpp::IntegerVector& x_dim,
+                                       const int& dim_n,
+                                       SEXPTYPE type,
+                                       const char* arg) {
+
+  const R_xlen_t n = x.size();
+  const R_xlen_t size = rray__dim_size(x_dim);
+
+  SEXP proxy = rray_shared_empty(type);
+
+  Rcpp::RObject out = Rf_allocVector(type, size * n);
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    Rcpp::RObject elt = x[i];
+
+    if (!r_identical(rray__dim(elt), x_dim)) {
+      Rcpp::stop(
+        "All elements of `%s` must have the same dimensions. Element %i has dimensions %s, not %s.",
+        arg,
+        i + 1,
+        rray__dim_to_string(rray__dim(elt)),
+        rray__dim_to_string(x_dim)
+      );
+    }
+
+    elt = vec__cast_inner(elt, proxy);
+
+    switch (type) {
+    case REALSXP: rray__batch_copy_into<double>(out, elt, i * size); break;
+    case INTSXP: rray__batch_copy_into<int>(out, elt, i * size); break;
+    default: rray__batch_copy_into<rlogical>(out, elt, i * size); break;
+    }
+  }
+
+  Rcpp::IntegerVector out_dim = rray__increase_dims(x_dim, dim_n + 1);
+  out_dim[dim_n] = n;
+  out.attr("dim") = out_dim;
+
+  return out;
+}
+
+// Split `x` along its trailing axis into a list of `n` arrays with dimensions
+// `dim`. Every element shares the same `dim_names` and class.
+
+static Rcpp::List rray__batch_split(SEXP x,
+                                    R_xlen_t n,
+                                    const Rcpp::IntegerVector& dim,
+                                    const Rcpp::List& dim_names,
+                                    bool is_rray) {
+
+  const SEXPTYPE type = TYPEOF(x);
+  const R_xlen_t size = rray__dim_size(dim);
+
+  Rcpp::CharacterVector cls;
+
+  if (is_rray) {
+    switch (type) {
+    case REALSXP: cls = Rcpp::CharacterVector::create("vctrs_rray_dbl", "vctrs_rray"); break;
+    case INTSXP: cls = Rcpp::CharacterVector::create("vctrs_rray_int", "vctrs_rray"); break;
+    default: cls = Rcpp::CharacterVector::create("vctrs_rray_lgl", "vctrs_rray"); break;
+    }
+  }
+
+  Rcpp::List out(n);
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    Rcpp::RObject elt = Rf_allocVector(type, size);
+
+    switch (type) {
+    case REALSXP: rray__batch_copy_from<double>(elt, x, i * size); break;
+    case INTSXP: rray__batch_copy_from<int>(elt, x, i * size); break;
+    default: rray__batch_copy_from<rlogical>(elt, x, i * size); break;
+    }
+
+    elt.attr("dim") = dim;
+    elt.attr("dimnames") = dim_names;
+
+    if (is_rray) {
+      elt.attr("class") = cls;
+    }
+
+    out[i] = elt;
+  }
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::List rray__batch_binary(Rcpp::List x,
+                              Rcpp::List y,
+                              int op,
+                              bool is_rray) {
+
+  if (x.size() != y.size()) {
+    Rcpp::stop("Internal error: Batches must have the same size.");
+  }
+
+  if (x.size() == 0) {
+    return Rcpp::List(0);
+  }
+
+  SEXPTYPE type = rray__batch_type(x, y);
+
+  if (op == rray_op_divide || op == rray_op_pow) {
+    type = REALSXP;
+  }
+
+  rray_binary_kernel kernel = rray__binary_kernel(static_cast<rray_binary_op>(op), type);
+
+  if (kernel == NULL) {
+    Rcpp::stop("Internal error: Unknown batched operation %i.", op);
+  }
+
+  Rcpp::IntegerVector x_dim = rray__dim(x[0]);
+  Rcpp::IntegerVector y_dim = rray__dim(y[0]);
+  Rcpp::IntegerVector dim = rray__dim2(x_dim, y_dim);
+
+  const int& dim_n = dim.size();
+
+  Rcpp::RObject x_stack = rray__batch_stack(x, x_dim, dim_n, type, "x");
+  Rcpp::RObject y_stack = rray__batch_stack(y, y_dim, dim_n, type, "y");
+
+  Rcpp::RObject out = kernel(x_stack, y_stack);
+
+  Rcpp::List dim_names = rray__dim_names2(x[0], y[0]);
+
+  return rray__batch_split(out, x.size(), dim, dim_names, is_rray);
+}
+
+// -----------------------------------------------------------------------------
+
+// Matrix products of `x` and `y` along the trailing axis of the result.
+// `x` is `m x k x n` and `y` is `k x p x n`.
+
+static Rcpp::RObject rray__batch_dot_impl(SEXP x, SEXP y, int m, int k, int p, R_xlen_t n) {
+
+  Rcpp::RObject out = Rf_allocVector(REALSXP, static_cast<R_xlen_t>(m) * p * n);
+  out.attr("dim") = Rcpp::IntegerVector::create(m, p, n);
+
+  const double* p_x = REAL(x);
+  const double* p_y = REAL(y);
+  double* p_out = REAL(out);
+
+  const R_xlen_t x_size = static_cast<R_xlen_t>(m) * k;
+  const R_xlen_t y_size = static_cast<R_xlen_t>(k) * p;
+  const R_xlen_t out_size = static_cast<R_xlen_t>(m) * p;
+
+  for (R_xlen_t b = 0; b < n; ++b) {
+    const double* p_x_b = p_x + b * x_size;
+    const double* p_y_b = p_y + b * y_size;
+    double* p_out_b = p_out + b * out_size;
+
+    std::fill(p_out_b, p_out_b + out_size, 0.0);
+
+    // Column by column, so every access is contiguous
+    for (int c = 0; c < p; ++c) {
+      for (int j = 0; j < k; ++j) {
+        const double y_jc = p_y_b[j + c * k];
+
+        for (int r = 0; r < m; ++r) {
+          p_out_b[r + c * m] += p_x_b[r + j * m] * y_jc;
+        }
+      }
+    }
+  }
+
+  return out;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::List rray__batch_dot(Rcpp::List x, Rcpp::List y, bool is_rray) {
+
+  if (x.size() != y.size()) {
+    Rcpp::stop("Internal error: Batches must have the same size.");
+  }
+
+  const R_xlen_t n = x.size();
+
+  if (n == 0) {
+    return Rcpp::List(0);
+  }
+
+  // Validates the inner types
+  rray__batch_type(x, y);
+
+  Rcpp::IntegerVector x_dim = rray__dim(x[0]);
+  Rcpp::IntegerVector y_dim = rray__dim(y[0]);
+
+  if (x_dim.size() != 2 || y_dim.size() != 2) {
+    Rcpp::stop("Batched matrix products require the elements of `x` and `y` to be matrices.");
+  }
+
+  if (x_dim[1] != y_dim[0]) {
+    Rcpp::stop(
+      "Non-conformable elements. `x` has %i columns, but `y` has %i rows.",
+      x_dim[1],
+      y_dim[0]
+    );
+  }
+
+  Rcpp::RObject x_stack = rray__batch_stack(x, x_dim, 2, REALSXP, "x");
+  Rcpp::RObject y_stack = rray__batch_stack(y, y_dim, 2, REALSXP, "y");
+
+  Rcpp::RObject out = rray__batch_dot_impl(x_stack, y_stack, x_dim[0], x_dim[1], y_dim[1], n);
+
+  Rcpp::List x_dim_names = rray__dim_names(x[0]);
+  Rcpp::List y_dim_names = rray__dim_names(y[0]);
+  Rcpp::List dim_names = Rcpp::List::create(x_dim_names[0], y_dim_names[1]);
+
+  Rcpp::IntegerVector dim = Rcpp::IntegerVector::create(x_dim[0], y_dim[1]);
+
+  return rray__batch_split(out, n, dim, dim_names, is_rray);
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__batch_dot_stacked(Rcpp::RObject x, Rcpp::RObject y) {
+  Rcpp::IntegerVector x_dim = rray__dim(x);
+  Rcpp::IntegerVector y_dim = rray__dim(y);
+
+  return rray__batch_dot_impl(x, y, x_dim[0], x_dim[1], y_dim[1], x_dim[2]);
+}
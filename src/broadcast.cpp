@@ -34,7 +34,7 @@ Rcpp::RObject rray__broadcast(Rcpp::RObject x, Rcpp::IntegerVector dim) {
   rray__validate_broadcastable_to_dim(x_dim, dim);
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__broadcast_impl, x, dim);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__broadcast_impl), x, dim);
 
   rray__resize_and_set_dim_names(out, x);
 
@@ -1,9 +1,50 @@
 #include <utils.h>
 #include <cast.h>
+#include <r-api.h>
 
 SEXP fns_vec_cast_inner = NULL;
 
-SEXP vec__cast_inner(SEXP x, SEXP to) {
+// -----------------------------------------------------------------------------
+
+// Lossless casts from logical / integer to a "larger" inner type. The
+// dimensions and dimension names are kept, like with `vec_cast_inner()`.
+// `NA_LOGICAL` and `NA_INTEGER` share a representation, so logical -> integer
+// is a plain copy.
+
+static SEXP vec__cast_inner_promote(SEXP x, SEXPTYPE to_type) {
+  R_xlen_t size = Rf_xlength(x);
+
+  SEXP out = PROTECT(Rf_allocVector(to_type, size));
+
+  const int* p_x = (TYPEOF(x) == LGLSXP) ? LOGICAL(x) : INTEGER(x);
+
+  if (to_type == INTSXP) {
+    int* p_out = INTEGER(out);
+    std::copy(p_x, p_x + size, p_out);
+  }
+  else {
+    double* p_out = REAL(out);
+
+    for (R_xlen_t i = 0; i < size; ++i) {
+      p_out[i] = (p_x[i] == NA_INTEGER) ? NA_REAL : p_x[i];
+    }
+  }
+
+  SEXP dim = Rf_getAttrib(x, R_DimSymbol);
+
+  if (r_is_null(dim)) {
+    Rf_setAttrib(out, R_NamesSymbol, Rf_getAttrib(x, R_NamesSymbol));
+  }
+  else {
+    Rf_setAttrib(out, R_DimSymbol, dim);
+    Rf_setAttrib(out, R_DimNamesSymbol, Rf_getAttrib(x, R_DimNamesSymbol));
+  }
+
+  UNPROTECT(1);
+  return out;
+}
+
+static SEXP vec__cast_inner_r(SEXP x, SEXP to) {
   SEXP env = PROTECT(r_new_environment(rray_ns_env, 2));
 
   Rf_defineVar(syms_x, x, env);
@@ -17,6 +58,34 @@ SEXP vec__cast_inner(SEXP x, SEXP to) {
   return res;
 }
 
+// Same inner type and lossless promotions are handled natively. Everything
+// else (potentially lossy casts, character, other classes) goes through
+// `vec_cast_inner()` so vctrs can perform the checks and signal errors.
+
+SEXP vec__cast_inner(SEXP x, SEXP to) {
+  if (r_is_null(x) || r_is_null(to)) {
+    return x;
+  }
+
+  SEXPTYPE x_type = rray_native_inner_type(x);
+  SEXPTYPE to_type = rray_native_inner_type(to);
+
+  if (x_type == NILSXP || to_type == NILSXP) {
+    return vec__cast_inner_r(x, to);
+  }
+
+  if (x_type == to_type) {
+    return x;
+  }
+
+  // SEXPTYPEs are ordered as LGLSXP < INTSXP < REALSXP
+  if (x_type < to_type) {
+    return vec__cast_inner_promote(x, to_type);
+  }
+
+  return vec__cast_inner_r(x, to);
+}
+
 void rray_init_cast(SEXP ns) {
   fns_vec_cast_inner = Rf_install("vec_cast_inner");
 }
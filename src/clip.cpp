@@ -43,7 +43,7 @@ Rcpp::RObject rray__clip(Rcpp::RObject x, Rcpp::RObject low, Rcpp::RObject high)
   }
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_TWO(out, rray__clip_impl, x, low, high);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__clip_impl), x, low, high);
   rray__set_dim_names(out, rray__dim_names(x));
   return out;
 }
@@ -3,17 +3,16 @@
 #include <cast.h>
 #include <utils.h>
 #include <type2.h>
+#include <kernels.h>
 
 // -----------------------------------------------------------------------------
 
-#define COMPARE_IMPL(FUN, X, Y)                                \
-  auto views = rray__increase_dims_view2(X, Y);                \
-  auto x_view = std::get<0>(views);                            \
-  auto y_view = std::get<1>(views);                            \
-                                                               \
-  xt::rarray<rlogical> res = FUN(x_view, y_view);              \
-                                                               \
-  return Rcpp::as<Rcpp::RObject>(res)
+#define COMPARE_IMPL(FUN, OP, X, Y)                                 \
+  return rray__elementwise2<rlogical>(                              \
+    X, Y, false,                                                    \
+    [](auto a, auto b) { return a OP b; },                          \
+    [](auto& x_view, auto& y_view) { return FUN(x_view, y_view); }  \
+  )
 
 // -----------------------------------------------------------------------------
 
@@ -33,7 +32,7 @@
   Y = vec__cast_inner(Y, type);                                \
                                                                \
   Rcpp::RObject out;                                           \
-  DISPATCH_BINARY(out, FUN, X, Y);                             \
+  out = rray__dispatch_binary(RRAY_LIFT(FUN), X, Y);           \
                                                                \
   out.attr("dimnames") = new_dim_names;                        \
                                                                \
@@ -44,7 +43,7 @@
 template <typename T>
 Rcpp::RObject rray__greater_impl(const xt::rarray<T>& x,
                                  const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::operator>, x, y);
+  COMPARE_IMPL(xt::operator>, >, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -57,7 +56,7 @@ Rcpp::RObject rray__greater(Rcpp::RObject x, Rcpp::RObject y) {
 template <typename T>
 Rcpp::RObject rray__greater_equal_impl(const xt::rarray<T>& x,
                                        const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::operator>=, x, y);
+  COMPARE_IMPL(xt::operator>=, >=, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -70,7 +69,7 @@ Rcpp::RObject rray__greater_equal(Rcpp::RObject x, Rcpp::RObject y) {
 template <typename T>
 Rcpp::RObject rray__lesser_impl(const xt::rarray<T>& x,
                                 const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::operator<, x, y);
+  COMPARE_IMPL(xt::operator<, <, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -83,7 +82,7 @@ Rcpp::RObject rray__lesser(Rcpp::RObject x, Rcpp::RObject y) {
 template <typename T>
 Rcpp::RObject rray__lesser_equal_impl(const xt::rarray<T>& x,
                                       const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::operator<=, x, y);
+  COMPARE_IMPL(xt::operator<=, <=, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -96,7 +95,7 @@ Rcpp::RObject rray__lesser_equal(Rcpp::RObject x, Rcpp::RObject y) {
 template <typename T>
 Rcpp::RObject rray__equal_impl(const xt::rarray<T>& x,
                                const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::equal, x, y);
+  COMPARE_IMPL(xt::equal, ==, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -109,7 +108,7 @@ Rcpp::RObject rray__equal(Rcpp::RObject x, Rcpp::RObject y) {
 template <typename T>
 Rcpp::RObject rray__not_equal_impl(const xt::rarray<T>& x,
                                    const xt::rarray<T>& y) {
-  COMPARE_IMPL(xt::not_equal, x, y);
+  COMPARE_IMPL(xt::not_equal, !=, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -151,7 +150,7 @@ Rcpp::RObject rray__all_equal(Rcpp::RObject x, Rcpp::RObject y) {
   }
 
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__all_equal_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__all_equal_impl), x, y);
 
   return out;
 }
@@ -188,9 +187,16 @@ Rcpp::RObject rray__any_not_equal(Rcpp::RObject x, Rcpp::RObject y) {
   }
 
   Rcpp::RObject out;
-  DISPATCH_BINARY(out, rray__any_not_equal_impl, x, y);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__any_not_equal_impl), x, y);
 
   return out;
 }
 
 // -----------------------------------------------------------------------------
+
+const rray_binary_kernels rray_greater_kernels = RRAY_BINARY_KERNELS(rray__greater_impl);
+const rray_binary_kernels rray_greater_equal_kernels = RRAY_BINARY_KERNELS(rray__greater_equal_impl);
+const rray_binary_kernels rray_lesser_kernels = RRAY_BINARY_KERNELS(rray__lesser_impl);
+const rray_binary_kernels rray_lesser_equal_kernels = RRAY_BINARY_KERNELS(rray__lesser_equal_impl);
+const rray_binary_kernels rray_equal_kernels = RRAY_BINARY_KERNELS(rray__equal_impl);
+const rray_binary_kernels rray_not_equal_kernels = RRAY_BINARY_KERNELS(rray__not_equal_impl);
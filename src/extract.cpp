@@ -27,7 +27,7 @@ Rcpp::RObject rray__extract_impl(const xt::rarray<T>& x, Rcpp::List indexer) {
 // [[Rcpp::export(rng = false)]]
 Rcpp::RObject rray__extract(Rcpp::RObject x, Rcpp::List indexer) {
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__extract_impl, x, indexer);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__extract_impl), x, indexer);
   rray__set_dim_names(out, rray__new_empty_dim_names(1));
   return out;
 }
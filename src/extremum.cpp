@@ -2,18 +2,19 @@
 #include <dispatch.h>
 #include <type2.h>
 #include <cast.h>
+#include <kernels.h>
 
 // -----------------------------------------------------------------------------
 
 template <typename T>
-xt::rarray<T> rray__maximum_impl(const xt::rarray<T>& x,
+Rcpp::RObject rray__maximum_impl(const xt::rarray<T>& x,
                                  const xt::rarray<T>& y) {
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  return xt::maximum(x_view, y_view);
+  return rray__elementwise2<T>(
+    x, y, false,
+    [](auto a, auto b) { return (a > b) ? a : b; },
+    [](auto& x_view, auto& y_view) { return xt::maximum(x_view, y_view); }
+  );
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -24,17 +25,22 @@ Rcpp::RObject rray__maximum(Rcpp::RObject x, Rcpp::RObject y) {
 // -----------------------------------------------------------------------------
 
 template <typename T>
-xt::rarray<T> rray__minimum_impl(const xt::rarray<T>& x,
+Rcpp::RObject rray__minimum_impl(const xt::rarray<T>& x,
                                  const xt::rarray<T>& y) {
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  return xt::minimum(x_view, y_view);
+  return rray__elementwise2<T>(
+    x, y, false,
+    [](auto a, auto b) { return (a < b) ? a : b; },
+    [](auto& x_view, auto& y_view) { return xt::minimum(x_view, y_view); }
+  );
 }
 
 // [[Rcpp::export(rng = false)]]
 Rcpp::RObject rray__minimum(Rcpp::RObject x, Rcpp::RObject y) {
   DISPATCH_BINARY_MATH(rray__minimum_impl, x, y);
 }
+
+// -----------------------------------------------------------------------------
+
+const rray_binary_kernels rray_maximum_kernels = RRAY_BINARY_KERNELS(rray__maximum_impl);
+const rray_binary_kernels rray_minimum_kernels = RRAY_BINARY_KERNELS(rray__minimum_impl);
@@ -0,0 +1,281 @@
+#include <rray.h>
+#include <dispatch.h>
+
+// -----------------------------------------------------------------------------
+
+// Keep in sync with `fuse_ops` in R/fuse.R
+enum fuse_op {
+  fuse_leaf = 0,
+  fuse_add = 1,
+  fuse_subtract = 2,
+  fuse_multiply = 3,
+  fuse_divide = 4,
+  fuse_pow = 5,
+  fuse_hypot = 6,
+  fuse_maximum = 7,
+  fuse_minimum = 8,
+  fuse_greater = 9,
+  fuse_greater_equal = 10,
+  fuse_lesser = 11,
+  fuse_lesser_equal = 12,
+  fuse_equal = 13,
+  fuse_not_equal = 14,
+  fuse_opposite = 15,
+  fuse_clip = 16
+};
+
+// The program is evaluated one block of the (column major) flattened result
+// at a time. Each block is small enough that the stack of intermediate
+// results stays in cache, which is the whole point of fusing.
+static const R_xlen_t fuse_block_size = 1024;
+
+// -----------------------------------------------------------------------------
+
+// A leaf is one of the inputs, along with its strides in the result. Axes
+// that are broadcast have a stride of 0.
+
+struct fuse_leaf_info {
+  const double* p_x;
+  R_xlen_t size;
+  std::vector<R_xlen_t> strides;
+};
+
+static fuse_leaf_info fuse_leaf_init(SEXP x, const Rcpp::IntegerVector& dim) {
+  if (TYPEOF(x) != REALSXP) {
+    Rcpp::stop("Internal error: Fused inputs must be doubles.");
+  }
+
+  std::vector<R_xlen_t> strides = rray__broadcast_strides(x, dim);
+
+  return fuse_leaf_info{REAL(x), Rf_xlength(x), strides};
+}
+
+// Copy the elements of `leaf` that correspond to the result positions
+// `[start, start + n)` into `p_out`.
+
+static void fuse_gather(const fuse_leaf_info& leaf,
+                        const Rcpp::IntegerVector& dim,
+                        R_xlen_t size,
+                        R_xlen_t start,
+                        R_xlen_t n,
+                        double* p_out) {
+
+  // No broadcasting required
+  if (leaf.size == size) {
+    std::copy(leaf.p_x + start, leaf.p_x + start + n, p_out);
+    return;
+  }
+
+  if (leaf.size == 1) {
+    std::fill(p_out, p_out + n, leaf.p_x[0]);
+    return;
+  }
+
+  const int& dim_n = dim.size();
+  std::vector<R_xlen_t> idx(dim_n);
+
+  // Locate `start` in the result and in `leaf`
+  R_xlen_t rem = start;
+  R_xlen_t offset = 0;
+
+  for (int j = 0; j < dim_n; ++j) {
+    idx[j] = rem % dim[j];
+    rem = rem / dim[j];
+    offset += idx[j] * leaf.strides[j];
+  }
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    p_out[i] = leaf.p_x[offset];
+
+    // Increment the position, carrying over into the next axes
+    for (int j = 0; j < dim_n; ++j) {
+      idx[j]++;
+      offset += leaf.strides[j];
+
+      if (idx[j] < dim[j]) {
+        break;
+      }
+
+      offset -= idx[j] * leaf.strides[j];
+      idx[j] = 0;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+static inline double fuse_compare(bool any_na, bool value) {
+  return any_na ? NA_REAL : static_cast<double>(value);
+}
+
+static void fuse_apply_binary(int op, double* p_x, const double* p_y, R_xlen_t n) {
+  switch (op) {
+  case fuse_add: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = p_x[i] + p_y[i]; break;
+  case fuse_subtract: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = p_x[i] - p_y[i]; break;
+  case fuse_multiply: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = p_x[i] * p_y[i]; break;
+  case fuse_divide: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = p_x[i] / p_y[i]; break;
+  case fuse_pow: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = std::pow(p_x[i], p_y[i]); break;
+  case fuse_hypot: for (R_xlen_t i = 0; i < n; ++i) p_x[i] = std::hypot(p_x[i], p_y[i]); break;
+  case fuse_maximum: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = (ISNAN(p_x[i]) || ISNAN(p_y[i])) ? p_x[i] + p_y[i] : std::max(p_x[i], p_y[i]);
+    }
+    break;
+  }
+  case fuse_minimum: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = (ISNAN(p_x[i]) || ISNAN(p_y[i])) ? p_x[i] + p_y[i] : std::min(p_x[i], p_y[i]);
+    }
+    break;
+  }
+  case fuse_greater: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] > p_y[i]);
+    }
+    break;
+  }
+  case fuse_greater_equal: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] >= p_y[i]);
+    }
+    break;
+  }
+  case fuse_lesser: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] < p_y[i]);
+    }
+    break;
+  }
+  case fuse_lesser_equal: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] <= p_y[i]);
+    }
+    break;
+  }
+  case fuse_equal: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] == p_y[i]);
+    }
+    break;
+  }
+  case fuse_not_equal: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_x[i] = fuse_compare(ISNAN(p_x[i]) || ISNAN(p_y[i]), p_x[i] != p_y[i]);
+    }
+    break;
+  }
+  default: Rcpp::stop("Internal error: Unknown fused operation %i.", op);
+  }
+}
+
+static bool fuse_is_comparison(int op) {
+  return op >= fuse_greater && op <= fuse_not_equal;
+}
+
+// -----------------------------------------------------------------------------
+
+// Validate the program and find the maximum stack depth required
+static int fuse_stack_depth(const Rcpp::IntegerVector& ops) {
+  int depth = 0;
+  int max_depth = 0;
+
+  for (int op : ops) {
+    if (op == fuse_leaf) {
+      depth++;
+    }
+    else if (op == fuse_opposite) {
+      // pop 1, push 1
+    }
+    else if (op == fuse_clip) {
+      depth -= 2;
+    }
+    else {
+      depth -= 1;
+    }
+
+    if (depth < 1) {
+      Rcpp::stop("Internal error: Malformed fused program.");
+    }
+
+    max_depth = std::max(depth, max_depth);
+  }
+
+  if (depth != 1) {
+    Rcpp::stop("Internal error: Malformed fused program.");
+  }
+
+  return max_depth;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__fuse(Rcpp::IntegerVector ops,
+                         Rcpp::IntegerVector args,
+                         Rcpp::List leaves,
+                         Rcpp::IntegerVector dim) {
+
+  const int& n_ops = ops.size();
+  const int& n_leaves = leaves.size();
+  const int& max_depth = fuse_stack_depth(ops);
+
+  R_xlen_t size = 1;
+  for (int i = 0; i < dim.size(); ++i) {
+    size *= dim[i];
+  }
+
+  std::vector<fuse_leaf_info> leaf_infos;
+  leaf_infos.reserve(n_leaves);
+
+  for (int i = 0; i < n_leaves; ++i) {
+    leaf_infos.push_back(fuse_leaf_init(leaves[i], dim));
+  }
+
+  bool is_logical = fuse_is_comparison(ops[n_ops - 1]);
+
+  Rcpp::RObject out = Rf_allocVector(is_logical ? LGLSXP : REALSXP, size);
+  out.attr("dim") = dim;
+
+  std::vector<std::vector<double>> stack(max_depth, std::vector<double>(fuse_block_size));
+
+  for (R_xlen_t start = 0; start < size; start += fuse_block_size) {
+    R_xlen_t n = std::min(fuse_block_size, size - start);
+    int sp = 0;
+
+    for (int i = 0; i < n_ops; ++i) {
+      const int& op = ops[i];
+
+      if (op == fuse_leaf) {
+        fuse_gather(leaf_infos[args[i]], dim, size, start, n, stack[sp].data());
+        sp++;
+      }
+      else if (op == fuse_opposite) {
+        double* p_x = stack[sp - 1].data();
+        for (R_xlen_t k = 0; k < n; ++k) p_x[k] = -p_x[k];
+      }
+      else if (op == fuse_clip) {
+        double* p_x = stack[sp - 3].data();
+        const double& low = stack[sp - 2][0];
+        const double& high = stack[sp - 1][0];
+        for (R_xlen_t k = 0; k < n; ++k) p_x[k] = std::min(std::max(p_x[k], low), high);
+        sp -= 2;
+      }
+      else {
+        fuse_apply_binary(op, stack[sp - 2].data(), stack[sp - 1].data(), n);
+        sp--;
+      }
+    }
+
+    const double* p_res = stack[0].data();
+
+    if (is_logical) {
+      int* p_out = LOGICAL(out) + start;
+      for (R_xlen_t k = 0; k < n; ++k) {
+        p_out[k] = ISNAN(p_res[k]) ? NA_LOGICAL : static_cast<int>(p_res[k]);
+      }
+    }
+    else {
+      std::copy(p_res, p_res + n, REAL(out) + start);
+    }
+  }
+
+  return out;
+}
@@ -62,7 +62,7 @@ Rcpp::RObject rray__reshape(Rcpp::RObject x, const Rcpp::IntegerVector& dim) {
   rray__validate_reshape(x, dim);
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__reshape_impl, x, dim);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__reshape_impl), x, dim);
 
   // Potentially going down in dimensionality, but this is fine
   Rcpp::List new_dim_names = rray__reshape_dim_names(rray__dim_names(x), x_dim, dim);
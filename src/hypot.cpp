@@ -2,21 +2,26 @@
 #include <dispatch.h>
 #include <cast.h>
 #include <type2.h>
+#include <kernels.h>
 
 // -----------------------------------------------------------------------------
 
 template <typename T>
-xt::rarray<double> rray__hypot_impl(const xt::rarray<T>& x,
-                                    const xt::rarray<T>& y) {
+Rcpp::RObject rray__hypot_impl(const xt::rarray<T>& x,
+                               const xt::rarray<T>& y) {
 
-  auto views = rray__increase_dims_view2(x, y);
-  auto x_view = std::get<0>(views);
-  auto y_view = std::get<1>(views);
-
-  return xt::hypot(x_view, y_view);
+  return rray__elementwise2<double>(
+    x, y, false,
+    [](auto a, auto b) { return std::hypot(a, b); },
+    [](auto& x_view, auto& y_view) { return xt::hypot(x_view, y_view); }
+  );
 }
 
 // [[Rcpp::export(rng = false)]]
 Rcpp::RObject rray__hypot(Rcpp::RObject x, Rcpp::RObject y) {
   DISPATCH_BINARY_MATH(rray__hypot_impl, x, y);
 }
+
+// -----------------------------------------------------------------------------
+
+const rray_binary_kernels rray_hypot_kernels = RRAY_BINARY_KERNELS(rray__hypot_impl);
@@ -0,0 +1,42 @@
+#include <kernels.h>
+
+// -----------------------------------------------------------------------------
+
+// Keep in sync with `rray_binary_op` in inst/include/kernels.h
+static const rray_binary_kernel* rray_binary_kernel_table[rray_n_binary_ops] = {
+  rray_add_kernels,
+  rray_subtract_kernels,
+  rray_multiply_kernels,
+  rray_divide_kernels,
+  rray_pow_kernels,
+  rray_maximum_kernels,
+  rray_minimum_kernels,
+  rray_hypot_kernels,
+  rray_greater_kernels,
+  rray_greater_equal_kernels,
+  rray_lesser_kernels,
+  rray_lesser_equal_kernels,
+  rray_equal_kernels,
+  rray_not_equal_kernels,
+  rray_logical_and_kernels,
+  rray_logical_or_kernels
+};
+
+static int rray__type_index(SEXPTYPE type) {
+  switch (type) {
+  case REALSXP: return 0;
+  case INTSXP: return 1;
+  case LGLSXP: return 2;
+  default: return -1;
+  }
+}
+
+rray_binary_kernel rray__binary_kernel(rray_binary_op op, SEXPTYPE type) {
+  int i = rray__type_index(type);
+
+  if (op < 0 || op >= rray_n_binary_ops || i == -1) {
+    return NULL;
+  }
+
+  return rray_binary_kernel_table[op][i];
+}
@@ -3,20 +3,16 @@
 #include <cast.h>
 #include <type2.h>
 #include <utils.h>
-
-// Required for any() and all()
-#include <xtensor/xarray.hpp>
+#include <kernels.h>
 
 // -----------------------------------------------------------------------------
 
-#define LOGICAL_IMPL(FUN, X, Y)                                  \
-  auto views = rray__increase_dims_view2(X, Y);                  \
-  auto x_view = std::get<0>(views);                              \
-  auto y_view = std::get<1>(views);                              \
-                                                                 \
-  xt::rarray<rlogical> res = FUN(x_view, y_view);                \
-                                                                 \
-  return Rcpp::as<Rcpp::RObject>(res)
+#define LOGICAL_IMPL(FUN, OP, X, Y)                                 \
+  return rray__elementwise2<rlogical>(                              \
+    X, Y, false,                                                    \
+    [](int a, int b) { return a OP b; },                            \
+    [](auto& x_view, auto& y_view) { return FUN(x_view, y_view); }  \
+  )
 
 // -----------------------------------------------------------------------------
 
@@ -35,7 +31,7 @@
   Y = vec__cast_inner(Y, rray_shared_empty_lgl);                 \
                                                                  \
   Rcpp::RObject out;                                             \
-  DISPATCH_BINARY(out, FUN, X, Y);                               \
+  out = rray__dispatch_binary(RRAY_LIFT(FUN), X, Y);             \
                                                                  \
   out.attr("dimnames") = new_dim_names;                          \
                                                                  \
@@ -45,7 +41,7 @@
 
 Rcpp::RObject rray__logical_and_impl(const xt::rarray<rlogical>& x,
                                      const xt::rarray<rlogical>& y) {
-  LOGICAL_IMPL(xt::operator&&, x, y);
+  LOGICAL_IMPL(xt::operator&&, &&, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -57,7 +53,7 @@ Rcpp::RObject rray__logical_and(Rcpp::RObject x, Rcpp::RObject y) {
 
 Rcpp::RObject rray__logical_or_impl(const xt::rarray<rlogical>& x,
                                     const xt::rarray<rlogical>& y) {
-  LOGICAL_IMPL(xt::operator||, x, y);
+  LOGICAL_IMPL(xt::operator||, ||, x, y);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -67,6 +63,16 @@ Rcpp::RObject rray__logical_or(Rcpp::RObject x, Rcpp::RObject y) {
 
 // -----------------------------------------------------------------------------
 
+const rray_binary_kernels rray_logical_and_kernels = {
+  NULL, NULL, RRAY_BINARY_KERNEL(rray__logical_and_impl, rlogical)
+};
+
+const rray_binary_kernels rray_logical_or_kernels = {
+  NULL, NULL, RRAY_BINARY_KERNEL(rray__logical_or_impl, rlogical)
+};
+
+// -----------------------------------------------------------------------------
+
 Rcpp::RObject rray__logical_not_impl(const xt::rarray<rlogical>& x) {
   xt::rarray<rlogical> out = xt::operator!(x);
   return Rcpp::as<Rcpp::RObject>(out);
@@ -89,37 +95,117 @@ Rcpp::RObject rray__logical_not(Rcpp::RObject x) {
 
 // -----------------------------------------------------------------------------
 
-// TODO - replace with native xt::any() if this issue is resolved
-// https://github.com/QuantStack/xtensor/issues/1555
-// Note that this is slower than it needs to be because it doesn't early exit
+// Logical values are scanned in blocks of `logical_block_size`. Within a
+// block, the values are combined without branching, so the compiler can
+// vectorize the loop and test several values per instruction. Whether the
+// result is known is only checked between blocks.
 
-// TODO - it also currently fails with multiple axes when one is size 0
-// https://github.com/QuantStack/xtensor/issues/1563
+static const R_xlen_t logical_block_size = 256;
 
-Rcpp::RObject rray__any_impl(const xt::rarray<rlogical>& x, Rcpp::RObject axes) {
+// Whether `p_x` has a `TRUE` value (with `is_any`) or a `FALSE` value.
+// Like `rray_any()` and `rray_all()`, missing values count as `TRUE`.
+template <bool is_any>
+static inline bool logical_find(const int* p_x, R_xlen_t n) {
+  for (R_xlen_t start = 0; start < n; start += logical_block_size) {
+    const R_xlen_t end = std::min(n, start + logical_block_size);
+
+    int found = 0;
+    for (R_xlen_t i = start; i < end; ++i) {
+      found |= is_any ? (p_x[i] != 0) : (p_x[i] == 0);
+    }
+
+    if (found) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// The same, split across threads. Every thread stops as soon as any of
+// them finds a value.
+template <bool is_any>
+static bool logical_find_parallel(const int* p_x, R_xlen_t size) {
+  std::atomic<bool> found(false);
+
+  rray__parallel_for(size, [&](R_xlen_t begin, R_xlen_t end) {
+    const R_xlen_t chunk = 16 * logical_block_size;
+
+    for (R_xlen_t start = begin; start < end; start += chunk) {
+      if (found.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      if (logical_find<is_any>(p_x + start, std::min(chunk, end - start))) {
+        found = true;
+        return;
+      }
+    }
+  });
+
+  return found;
+}
 
-  // Currently required to materialize into a xarray<bool> before going to rarray<rlogical>
-  xt::xarray<bool> x_reduced;
-  xt::rarray<rlogical> out;
+// -----------------------------------------------------------------------------
+
+// Like `any()` and `all()` on logical vectors, except that missing values
+// count as `TRUE`. Runs that are reduced into a single cell stop as soon
+// as their result is known, and so do full reductions.
+
+template <bool is_any>
+struct rray_any_all_reducer {
+  typedef int acc_type;
 
-  // If `axes = NULL` we can rely on `xt::any()` which finds a "global" any value
-  // If `axes != NULL` we implement our own custom reducer
-  if (r_is_null(axes)) {
-    x_reduced = xt::any(x);
+  inline acc_type init() const {
+    return !is_any;
   }
-  else {
-    auto any_reducer = xt::make_xreducer_functor(
-      [](bool a, bool b) { return a || b; },
-      xt::const_value<bool>(false)
-    );
 
-    std::vector<std::size_t> xt_axes = Rcpp::as<std::vector<std::size_t>>(axes);
+  inline void run(acc_type& acc, const int* p_x, R_xlen_t n) const {
+    if (acc != is_any && logical_find<is_any>(p_x, n)) {
+      acc = is_any;
+    }
+  }
 
-    x_reduced = xt::reduce(any_reducer, x, xt_axes);
+  inline void step(acc_type* p_acc, const int* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      if (is_any) {
+        p_acc[i] |= (p_x[i] != 0);
+      }
+      else {
+        p_acc[i] &= (p_x[i] != 0);
+      }
+    }
   }
 
-  out = rray__keep_dims_view(x_reduced, rray__dim(SEXP(x)), axes);
-  return Rcpp::as<Rcpp::RObject>(out);
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    acc = is_any ? (acc || other) : (acc && other);
+  }
+};
+
+template <bool is_any>
+Rcpp::RObject rray__any_all_impl(const xt::rarray<rlogical>& x, Rcpp::RObject axes) {
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const int* p_x = rray_storage<rlogical>::ptr(SEXP(x));
+
+  Rcpp::RObject out = Rf_allocVector(LGLSXP, plan.out_size);
+  out.attr("dim") = plan.out_dim;
+
+  int* p_out = LOGICAL(out);
+
+  if (plan.out_size == 1) {
+    const bool found = logical_find_parallel<is_any>(p_x, plan.size);
+    p_out[0] = found ? is_any : !is_any;
+    return out;
+  }
+
+  std::vector<int> cells = rray__reduce(plan, rray_any_all_reducer<is_any>(), p_x);
+  std::copy(cells.begin(), cells.end(), p_out);
+
+  return out;
+}
+
+Rcpp::RObject rray__any_impl(const xt::rarray<rlogical>& x, Rcpp::RObject axes) {
+  return rray__any_all_impl<true>(x, axes);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -140,42 +226,95 @@ Rcpp::RObject rray__any(Rcpp::RObject x, Rcpp::RObject axes) {
 
 // -----------------------------------------------------------------------------
 
-// TODO - replace with native xt::all() if this issue is resolved
-// https://github.com/QuantStack/xtensor/issues/1555
-// Note that this is slower than it needs to be because it doesn't early exit
-
-// TODO - it also currently fails with multiple axes when one is size 0
-// https://github.com/QuantStack/xtensor/issues/1563
-
 Rcpp::RObject rray__all_impl(const xt::rarray<rlogical>& x,
                              Rcpp::RObject axes) {
+  return rray__any_all_impl<false>(x, axes);
+}
 
-  // Currently required to materialize into a xarray<bool> before going to rarray<rlogical>
-  xt::xarray<bool> x_reduced;
-  xt::rarray<rlogical> out;
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__all(Rcpp::RObject x, Rcpp::RObject axes) {
 
-  // If `axes = NULL` we can rely on `xt::all()` which finds a "global" all value
-  // If `axes != NULL` we implement our own custom reducer
-  if (r_is_null(axes)) {
-    x_reduced = xt::all(x);
+  if (r_is_null(x)) {
+    x = rray_shared_empty_lgl;
   }
-  else {
-    auto all_reducer = xt::make_xreducer_functor(
-      [](bool a, bool b) { return a && b; },
-      xt::const_value<bool>(true)
-    );
 
-    std::vector<std::size_t> xt_axes = Rcpp::as<std::vector<std::size_t>>(axes);
+  Rcpp::RObject x_cast = vec__cast_inner(x, rray_shared_empty_lgl);
+
+  Rcpp::RObject out = rray__all_impl(xt::rarray<rlogical>(x_cast), axes);
+
+  rray__resize_and_set_dim_names(out, x);
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// Counts the `TRUE` values, along with the missing values, which are
+// otherwise non-zero. Both counts are accumulated without branching.
+
+struct rray_count_acc {
+  R_xlen_t n_true;
+  R_xlen_t n_na;
+
+  rray_count_acc() : n_true(0), n_na(0) {}
+};
+
+struct rray_count_reducer {
+  typedef rray_count_acc acc_type;
 
-    x_reduced = xt::reduce(all_reducer, x, xt_axes);
+  inline acc_type init() const {
+    return acc_type();
   }
 
-  out = rray__keep_dims_view(x_reduced, rray__dim(SEXP(x)), axes);
-  return Rcpp::as<Rcpp::RObject>(out);
+  inline void run(acc_type& acc, const int* p_x, R_xlen_t n) const {
+    R_xlen_t n_non_zero = 0;
+    R_xlen_t n_na = 0;
+
+    for (R_xlen_t i = 0; i < n; ++i) {
+      n_non_zero += (p_x[i] != 0);
+      n_na += (p_x[i] == NA_LOGICAL);
+    }
+
+    acc.n_true += n_non_zero - n_na;
+    acc.n_na += n_na;
+  }
+
+  inline void step(acc_type* p_acc, const int* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      const bool is_na = p_x[i] == NA_LOGICAL;
+      p_acc[i].n_true += (p_x[i] != 0) && !is_na;
+      p_acc[i].n_na += is_na;
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    acc.n_true += other.n_true;
+    acc.n_na += other.n_na;
+  }
+};
+
+Rcpp::RObject rray__count_impl(const xt::rarray<rlogical>& x,
+                               Rcpp::RObject axes,
+                               bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const int* p_x = rray_storage<rlogical>::ptr(SEXP(x));
+
+  std::vector<rray_count_acc> cells = rray__reduce(plan, rray_count_reducer(), p_x);
+
+  Rcpp::RObject out = rray__reduce_out(plan, 0);
+  double* p_out = REAL(out);
+
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    const bool is_na = !na_rm && cells[i].n_na > 0;
+    p_out[i] = is_na ? NA_REAL : cells[i].n_true;
+  }
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__all(Rcpp::RObject x, Rcpp::RObject axes) {
+Rcpp::RObject rray__count(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
 
   if (r_is_null(x)) {
     x = rray_shared_empty_lgl;
@@ -183,7 +322,7 @@ Rcpp::RObject rray__all(Rcpp::RObject x, Rcpp::RObject axes) {
 
   Rcpp::RObject x_cast = vec__cast_inner(x, rray_shared_empty_lgl);
 
-  Rcpp::RObject out = rray__all_impl(xt::rarray<rlogical>(x_cast), axes);
+  Rcpp::RObject out = rray__count_impl(xt::rarray<rlogical>(x_cast), axes, na_rm);
 
   rray__resize_and_set_dim_names(out, x);
 
@@ -235,7 +374,7 @@ Rcpp::RObject rray__if_else(Rcpp::RObject condition,
   false_ = vec__cast_inner(false_, type);
 
   Rcpp::RObject out;
-  DISPATCH_BINARY_ONE(out, rray__if_else_impl, true_, false_, condition);
+  out = rray__dispatch_binary(RRAY_LIFT(rray__if_else_impl), true_, false_, condition);
 
   out.attr("dimnames") = new_dim_names;
 
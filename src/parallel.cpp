@@ -0,0 +1,29 @@
+#include <tools/parallel.h>
+
+// -----------------------------------------------------------------------------
+
+int rray_n_threads = 1;
+
+// [[Rcpp::export(rng = false)]]
+int rray__set_threads(int n) {
+
+  if (n < 1) {
+    Rcpp::stop("`n` must be a positive integer.");
+  }
+
+#ifndef _OPENMP
+  if (n > 1) {
+    Rcpp::warning("rray was compiled without OpenMP support. Kernels will run serially.");
+  }
+#endif
+
+  int old = rray_n_threads;
+  rray_n_threads = n;
+
+  return old;
+}
+
+// [[Rcpp::export(rng = false)]]
+int rray__threads() {
+  return rray_n_threads;
+}
@@ -1,12 +1,8 @@
-#include <xtensor/xsort.hpp>
+#include <cstring>
 #include <rray.h>
 #include <dispatch.h>
 #include <tools/tools.h>
 
-// TODO - Until this is fixed:
-// https://github.com/QuantStack/xtensor-r/issues/113
-#include <xtensor/xarray.hpp>
-
 // -----------------------------------------------------------------------------
 
 // Remove dim names along the axis you sort over,
@@ -30,23 +26,341 @@ Rcpp::List sort_dim_names(const Rcpp::List& dim_names, Rcpp::RObject axis) {
   return new_dim_names;
 }
 
-template <typename T>
-Rcpp::RObject rray__sort_impl(const xt::rarray<T>& x, Rcpp::RObject axis) {
+// -----------------------------------------------------------------------------
+
+// Lanes
+//
+// With `axis`, `x` is seen as `outer` slabs of `n` rows of `inner`
+// contiguous elements, where `n` is the size of `axis`, so every lane along
+// `axis` starts at `o * n * inner + i` and has a stride of `inner`. Without
+// `axis`, the flattened `x` is a single lane with a stride of 1, so it is
+// never copied into another layout.
+//
+// Each lane is gathered into scratch space owned by its thread, which is
+// reused for every lane of that thread. Lanes are split across threads.
+
+struct rray_lanes {
+  R_xlen_t inner;
+  R_xlen_t n;
+  R_xlen_t outer;
 
-  using vec_size_t = typename std::vector<std::size_t>;
-  xt::rarray<T> out;
+  inline R_xlen_t size() const {
+    return inner * outer;
+  }
+
+  inline R_xlen_t start(R_xlen_t lane) const {
+    return (lane / inner) * n * inner + lane % inner;
+  }
+};
+
+static rray_lanes rray__lanes(Rcpp::IntegerVector dim, Rcpp::RObject axis) {
+  const R_xlen_t size = rray__dim_size(dim);
 
   if (r_is_null(axis)) {
-    auto flat_res = xt::sort(x, xt::placeholders::xtuph());
-    const vec_size_t& shape = Rcpp::as<vec_size_t>(rray__dim(SEXP(x)));
-    out = xt::reshape_view<xt::layout_type::column_major>(flat_res, shape);
+    return rray_lanes{1, size, 1};
   }
-  else {
-    std::ptrdiff_t xt_axis = Rcpp::as<std::ptrdiff_t>(axis);
-    out = xt::sort(x, xt_axis);
+
+  const int int_axis = Rcpp::as<int>(axis);
+
+  R_xlen_t inner = 1;
+  R_xlen_t outer = 1;
+
+  for (int i = 0; i < int_axis; ++i) {
+    inner *= dim[i];
   }
 
-  return Rcpp::as<Rcpp::RObject>(out);
+  for (int i = int_axis + 1; i < dim.size(); ++i) {
+    outer *= dim[i];
+  }
+
+  return rray_lanes{inner, static_cast<R_xlen_t>(dim[int_axis]), outer};
+}
+
+// Calls `f(thread, lane_begin, lane_end)` once per thread
+template <class F>
+static void rray__for_each_lanes(const rray_lanes& lanes, F f) {
+  const R_xlen_t n_lanes = lanes.size();
+
+  if (n_lanes == 0 || lanes.n == 0) {
+    return;
+  }
+
+  const int n_threads = std::min<R_xlen_t>(rray__threads_for(n_lanes * lanes.n), n_lanes);
+
+  rray__parallel_each(n_threads, [&](int thread) {
+    const R_xlen_t begin = n_lanes * thread / n_threads;
+    const R_xlen_t end = n_lanes * (thread + 1) / n_threads;
+
+    f(thread, begin, end);
+  });
+}
+
+// Orders values like `order()`, with missing values last whatever the
+// direction
+template <typename S, bool decreasing>
+struct rray_sort_less {
+  inline bool operator()(S a, S b) const {
+    const bool a_na = rray__is_na(a);
+    const bool b_na = rray__is_na(b);
+
+    if (a_na || b_na) {
+      return !a_na && b_na;
+    }
+
+    return decreasing ? a > b : a < b;
+  }
+};
+
+// -----------------------------------------------------------------------------
+
+// Sorting picks a strategy per type and lane length:
+//
+// - Logicals are counted, and written back as `FALSE`, then `TRUE`.
+//
+// - Integers and doubles in lanes of at least `sort_radix_threshold`
+//   elements are sorted with an LSD radix sort of 8 bit digits, on unsigned
+//   keys that order like the values. Digits that are the same for every key
+//   of a lane are skipped, so integers spanning a small range only take one
+//   or two passes.
+//
+// - Shorter lanes use a stable comparison sort.
+//
+// Like `sort(na.last = TRUE)`, missing values are placed last, in their
+// original order. They are set aside before the radix sort, so they don't
+// need a key.
+
+static const R_xlen_t sort_radix_threshold = 256;
+
+template <typename S>
+struct rray_radix_key;
+
+template <>
+struct rray_radix_key<int> {
+  typedef uint32_t type;
+
+  static inline uint32_t encode(int x) {
+    return static_cast<uint32_t>(x) ^ 0x80000000u;
+  }
+
+  static inline int decode(uint32_t key) {
+    return static_cast<int>(key ^ 0x80000000u);
+  }
+};
+
+// Positive doubles order like their bits, so only the sign bit is flipped.
+// Negative doubles order in reverse, so every bit is flipped.
+template <>
+struct rray_radix_key<double> {
+  typedef uint64_t type;
+
+  static inline uint64_t encode(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(double));
+    return (bits >> 63) ? ~bits : bits ^ (uint64_t(1) << 63);
+  }
+
+  static inline double decode(uint64_t key) {
+    uint64_t bits = (key >> 63) ? key ^ (uint64_t(1) << 63) : ~key;
+    double x;
+    std::memcpy(&x, &bits, sizeof(double));
+    return x;
+  }
+};
+
+// Sorts `p_keys`, using `p_tmp` as scratch space of the same size
+template <typename K>
+static void radix_sort(K* p_keys, K* p_tmp, R_xlen_t n) {
+  if (n == 0) {
+    return;
+  }
+
+  const int n_digits = sizeof(K);
+
+  R_xlen_t counts[sizeof(K)][256] = {};
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    const K key = p_keys[i];
+
+    for (int d = 0; d < n_digits; ++d) {
+      counts[d][(key >> (8 * d)) & 0xFF]++;
+    }
+  }
+
+  K* p_from = p_keys;
+  K* p_to = p_tmp;
+
+  for (int d = 0; d < n_digits; ++d) {
+    const int shift = 8 * d;
+    R_xlen_t* p_counts = counts[d];
+
+    if (p_counts[(p_from[0] >> shift) & 0xFF] == n) {
+      continue;
+    }
+
+    R_xlen_t offset = 0;
+
+    for (int b = 0; b < 256; ++b) {
+      const R_xlen_t count = p_counts[b];
+      p_counts[b] = offset;
+      offset += count;
+    }
+
+    for (R_xlen_t i = 0; i < n; ++i) {
+      const K key = p_from[i];
+      p_to[p_counts[(key >> shift) & 0xFF]++] = key;
+    }
+
+    std::swap(p_from, p_to);
+  }
+
+  if (p_from != p_keys) {
+    std::copy(p_from, p_from + n, p_keys);
+  }
+}
+
+// Scratch space of a thread, reused for all of its lanes
+template <typename S>
+struct rray_sort_scratch {
+  typedef typename rray_radix_key<S>::type K;
+
+  std::vector<S> values;
+  std::vector<K> keys;
+  std::vector<K> tmp;
+
+  rray_sort_scratch(R_xlen_t n, bool radix) : values(n) {
+    if (radix) {
+      keys.resize(n);
+      tmp.resize(n);
+    }
+  }
+};
+
+template <typename S>
+static void counting_sort_lane(const S* p_x,
+                               S* p_out,
+                               R_xlen_t n,
+                               R_xlen_t stride) {
+
+  R_xlen_t n_false = 0;
+  R_xlen_t n_na = 0;
+
+  for (R_xlen_t k = 0; k < n; ++k) {
+    const S x = p_x[k * stride];
+    n_na += rray__is_na(x);
+    n_false += (x == 0);
+  }
+
+  const R_xlen_t n_true = n - n_false - n_na;
+
+  R_xlen_t k = 0;
+
+  for (; k < n_false; ++k) {
+    p_out[k * stride] = 0;
+  }
+
+  for (; k < n_false + n_true; ++k) {
+    p_out[k * stride] = 1;
+  }
+
+  for (; k < n; ++k) {
+    p_out[k * stride] = rray__na<S>();
+  }
+}
+
+template <typename S>
+static void sort_lane(const S* p_x,
+                      S* p_out,
+                      R_xlen_t n,
+                      R_xlen_t stride,
+                      bool radix,
+                      rray_sort_scratch<S>& scratch) {
+
+  typedef rray_radix_key<S> key;
+  typedef typename key::type K;
+
+  S* p_values = scratch.values.data();
+
+  if (!radix) {
+    for (R_xlen_t k = 0; k < n; ++k) {
+      p_values[k] = p_x[k * stride];
+    }
+
+    std::stable_sort(p_values, p_values + n, rray_sort_less<S, false>());
+
+    for (R_xlen_t k = 0; k < n; ++k) {
+      p_out[k * stride] = p_values[k];
+    }
+
+    return;
+  }
+
+  // Keys of the values, with missing values set aside at the end of
+  // `p_values`
+  K* p_keys = scratch.keys.data();
+  R_xlen_t n_keys = 0;
+  R_xlen_t n_na = 0;
+
+  for (R_xlen_t k = 0; k < n; ++k) {
+    const S x = p_x[k * stride];
+
+    if (rray__is_na(x)) {
+      p_values[n - 1 - n_na] = x;
+      n_na++;
+    }
+    else {
+      p_keys[n_keys] = key::encode(x);
+      n_keys++;
+    }
+  }
+
+  radix_sort(p_keys, scratch.tmp.data(), n_keys);
+
+  for (R_xlen_t k = 0; k < n_keys; ++k) {
+    p_out[k * stride] = key::decode(p_keys[k]);
+  }
+
+  // Missing values were stored back to front
+  for (R_xlen_t k = 0; k < n_na; ++k) {
+    p_out[(n_keys + k) * stride] = p_values[n - 1 - k];
+  }
+}
+
+template <typename T>
+Rcpp::RObject rray__sort_impl(const xt::rarray<T>& x, Rcpp::RObject axis) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  const rray_lanes lanes = rray__lanes(dim, axis);
+
+  Rcpp::RObject out = Rf_allocVector(rray_storage<T>::sexptype, rray__dim_size(dim));
+  out.attr("dim") = dim;
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+  S* p_out = rray_storage<T>::ptr(out);
+
+  const bool counting = rray_storage<T>::sexptype == LGLSXP;
+  const bool radix = !counting && lanes.n >= sort_radix_threshold;
+
+  rray__for_each_lanes(lanes, [&](int thread, R_xlen_t begin, R_xlen_t end) {
+    if (counting) {
+      for (R_xlen_t lane = begin; lane < end; ++lane) {
+        const R_xlen_t start = lanes.start(lane);
+        counting_sort_lane(p_x + start, p_out + start, lanes.n, lanes.inner);
+      }
+
+      return;
+    }
+
+    rray_sort_scratch<S> scratch(lanes.n, radix);
+
+    for (R_xlen_t lane = begin; lane < end; ++lane) {
+      const R_xlen_t start = lanes.start(lane);
+      sort_lane(p_x + start, p_out + start, lanes.n, lanes.inner, radix, scratch);
+    }
+  });
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -56,7 +370,7 @@ Rcpp::RObject rray__sort(Rcpp::RObject x, Rcpp::RObject axis) {
   }
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__sort_impl, x, axis);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__sort_impl), x, axis);
 
   rray__set_dim_names(out, sort_dim_names(rray__dim_names(x), axis));
 
@@ -65,122 +379,435 @@ Rcpp::RObject rray__sort(Rcpp::RObject x, Rcpp::RObject axis) {
 
 // -----------------------------------------------------------------------------
 
-// TODO - simplify this after this is fixed
-// https://github.com/QuantStack/xtensor-r/issues/113
+// Sort positions are computed by sorting a buffer of indices per lane, with
+// a stable sort so that ties keep their original order, like `order()`. The
+// values of the lane are gathered next to each other first, so that the
+// comparisons don't have to stride through `x`.
+
+template <typename S, bool decreasing>
+static void sort_pos_lane(const S* p_x,
+                          int* p_out,
+                          R_xlen_t n,
+                          R_xlen_t stride,
+                          std::vector<S>& values,
+                          std::vector<int>& idx) {
+
+  for (R_xlen_t k = 0; k < n; ++k) {
+    values[k] = p_x[k * stride];
+    idx[k] = k;
+  }
 
-/// TODO - Flattening argsort() is broken for column major xarrays
-// (and by extension rarrays)
-// https://github.com/QuantStack/xtensor/issues/1537
+  const rray_sort_less<S, decreasing> less;
+  const S* p_values = values.data();
 
-// template <typename T>
-// xt::rarray<int> rray__sort_pos_impl(const xt::rarray<T>& x, Rcpp::RObject axis) {
-//
-//   if (r_is_null(axis)) {
-//     // TODO - Temporarily go through xarray for argsort() to work
-//     using underlying_type = typename xt::r_detail::get_underlying_value_type_r<T>::type;
-//     xt::xarray<underlying_type, xt::layout_type::column_major> x_xarray(x);
-//
-//     auto x_sort = xt::argsort(x_xarray, xt::placeholders::xtuph());
-//     auto x_r_idx = rray__as_r_idx(x_sort);
-//     xt::xarray<int, xt::layout_type::column_major> out_xarray(x_r_idx);
-//     xt::rarray<int> out(out_xarray);
-//
-//     return out;
-//   }
-//
-//   // TODO - Temporarily go through xarray for argsort() to work
-//   using underlying_type = typename xt::r_detail::get_underlying_value_type_r<T>::type;
-//   xt::xarray<underlying_type, xt::layout_type::column_major> x_xarray(x);
-//
-//   std::ptrdiff_t xt_axis = Rcpp::as<std::ptrdiff_t>(axis);
-//   auto x_sort = xt::argsort(x_xarray, xt_axis);
-//   auto x_r_idx = rray__as_r_idx(x_sort);
-//   xt::xarray<int, xt::layout_type::column_major> out_xarray(x_r_idx);
-//   xt::rarray<int> out(out_xarray);
-//
-//   return out;
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// Rcpp::RObject rray__sort_pos(Rcpp::RObject x, Rcpp::RObject axis) {
-//   DISPATCH_UNARY_ONE(rray__sort_pos_impl, x, axis);
-// }
-
-// -----------------------------------------------------------------------------
+  std::stable_sort(idx.begin(), idx.end(), [&](int a, int b) {
+    return less(p_values[a], p_values[b]);
+  });
 
-// Note: if axis != "leading axis" then a copy of `x` is made
-// https://github.com/QuantStack/xtensor/blob/7f1d93b5dd5b405a74febe70d2a1515611b1e2a6/include/xtensor/xsort.hpp#L867
-// Notable difference between:
-// x <- matrix(1:5000, 5000, 5000) + 0L
-// profmem::profmem(rray__argmax(x, 1)) # not leading axis, slow
-// profmem::profmem(rray__argmax(x, 0)) # leading axis, fast
+  for (R_xlen_t k = 0; k < n; ++k) {
+    p_out[k * stride] = idx[k] + 1;
+  }
+}
 
 template <typename T>
-Rcpp::RObject rray__max_pos_impl(const xt::rarray<T>& x, Rcpp::RObject axis) {
+Rcpp::RObject rray__sort_pos_impl(const xt::rarray<T>& x,
+                                  Rcpp::RObject axis,
+                                  bool decreasing) {
+
+  typedef typename rray_storage<T>::type S;
 
   Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  const rray_lanes lanes = rray__lanes(dim, axis);
 
-  if (r_is_null(axis)) {
-    auto x_argmax = xt::argmax<xt::layout_type::column_major>(x);
-    auto x_reshape = rray__keep_dims_view(x_argmax, dim, axis);
-    xt::rarray<int> out = rray__as_r_idx(x_reshape);
-    return Rcpp::as<Rcpp::RObject>(out);
+  if (lanes.n > INT_MAX) {
+    Rcpp::stop("Can't compute sort positions past the maximum integer.");
   }
 
-  std::size_t xt_axis = Rcpp::as<std::size_t>(axis);
-  auto x_argmax = xt::argmax<xt::layout_type::column_major>(x, xt_axis);
-  auto x_reshape = rray__keep_dims_view(x_argmax, dim, axis);
-  xt::rarray<int> out = rray__as_r_idx(x_reshape);
+  Rcpp::RObject out = Rf_allocVector(INTSXP, rray__dim_size(dim));
+  out.attr("dim") = dim;
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+  int* p_out = INTEGER(out);
 
-  return Rcpp::as<Rcpp::RObject>(out);
+  rray__for_each_lanes(lanes, [&](int thread, R_xlen_t begin, R_xlen_t end) {
+    std::vector<S> values(lanes.n);
+    std::vector<int> idx(lanes.n);
+
+    for (R_xlen_t lane = begin; lane < end; ++lane) {
+      const R_xlen_t start = lanes.start(lane);
+
+      if (decreasing) {
+        sort_pos_lane<S, true>(p_x + start, p_out + start, lanes.n, lanes.inner, values, idx);
+      }
+      else {
+        sort_pos_lane<S, false>(p_x + start, p_out + start, lanes.n, lanes.inner, values, idx);
+      }
+    }
+  });
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__max_pos(Rcpp::RObject x, Rcpp::RObject axis) {
-
+Rcpp::RObject rray__sort_pos(Rcpp::RObject x, Rcpp::RObject axis, bool decreasing) {
   if (r_is_null(x)) {
     return x;
   }
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__max_pos_impl, x, axis);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__sort_pos_impl), x, axis, decreasing);
 
-  rray__resize_and_set_dim_names(out, x);
+  rray__set_dim_names(out, sort_dim_names(rray__dim_names(x), axis));
 
   return out;
 }
 
 // -----------------------------------------------------------------------------
 
+// The top `k` values of every lane are selected with a heap of size `k`,
+// whose root is the worst value kept so far. Every value of the lane is
+// compared against the root and only replaces it when it is better, so the
+// cost is `O(n log(k))` and the heap is the only scratch space. The heap is
+// then sorted best first, and written to the `k` rows of the lane in the
+// output.
+//
+// Values are ordered like `rray_sort_pos()`, so missing values come last
+// and ties are broken by position.
+
+template <typename S>
+struct rray_top_k_entry {
+  S value;
+  int pos;
+};
+
+template <typename S, bool decreasing>
+struct rray_top_k_better {
+  rray_sort_less<S, decreasing> less;
+
+  inline bool operator()(const rray_top_k_entry<S>& a, const rray_top_k_entry<S>& b) const {
+    if (less(a.value, b.value)) {
+      return true;
+    }
+
+    if (less(b.value, a.value)) {
+      return false;
+    }
+
+    return a.pos < b.pos;
+  }
+};
+
+template <typename S, bool decreasing>
+static void top_k_lane(const S* p_x,
+                       S* p_values,
+                       int* p_positions,
+                       R_xlen_t n,
+                       R_xlen_t k,
+                       R_xlen_t stride,
+                       R_xlen_t out_stride,
+                       std::vector<rray_top_k_entry<S>>& heap) {
+
+  // With `better` as the heap comparison, the root is the worst entry
+  const rray_top_k_better<S, decreasing> better;
+
+  heap.clear();
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    const rray_top_k_entry<S> entry{p_x[i * stride], static_cast<int>(i)};
+
+    if (static_cast<R_xlen_t>(heap.size()) < k) {
+      heap.push_back(entry);
+      std::push_heap(heap.begin(), heap.end(), better);
+      continue;
+    }
+
+    if (better(entry, heap.front())) {
+      std::pop_heap(heap.begin(), heap.end(), better);
+      heap.back() = entry;
+      std::push_heap(heap.begin(), heap.end(), better);
+    }
+  }
+
+  std::sort_heap(heap.begin(), heap.end(), better);
+
+  for (R_xlen_t i = 0; i < k; ++i) {
+    p_values[i * out_stride] = heap[i].value;
+    p_positions[i * out_stride] = heap[i].pos + 1;
+  }
+}
+
 template <typename T>
-Rcpp::RObject rray__min_pos_impl(xt::rarray<T> x, Rcpp::RObject axis) {
+Rcpp::RObject rray__top_k_impl(const xt::rarray<T>& x,
+                               R_xlen_t k,
+                               Rcpp::RObject axis,
+                               bool decreasing) {
+
+  typedef typename rray_storage<T>::type S;
 
   Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  const rray_lanes lanes = rray__lanes(dim, axis);
 
-  if (r_is_null(axis)) {
-    auto x_argmax = xt::argmin<xt::layout_type::column_major>(x);
-    auto x_reshape = rray__keep_dims_view(x_argmax, dim, axis);
-    xt::rarray<int> out = rray__as_r_idx(x_reshape);
-    return Rcpp::as<Rcpp::RObject>(out);
+  const int int_axis = Rcpp::as<int>(axis);
+
+  if (k > lanes.n) {
+    Rcpp::stop("Internal error: `k` is larger than the size of `axis`.");
+  }
+
+  Rcpp::IntegerVector out_dim = Rcpp::clone(dim);
+  out_dim[int_axis] = k;
+
+  const R_xlen_t out_size = rray__dim_size(out_dim);
+
+  Rcpp::RObject values = Rf_allocVector(rray_storage<T>::sexptype, out_size);
+  values.attr("dim") = out_dim;
+
+  Rcpp::RObject positions = Rf_allocVector(INTSXP, out_size);
+  positions.attr("dim") = out_dim;
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+  S* p_values = rray_storage<T>::ptr(values);
+  int* p_positions = INTEGER(positions);
+
+  if (k > 0) {
+    rray__for_each_lanes(lanes, [&](int thread, R_xlen_t begin, R_xlen_t end) {
+      std::vector<rray_top_k_entry<S>> heap;
+      heap.reserve(k);
+
+      for (R_xlen_t lane = begin; lane < end; ++lane) {
+        const R_xlen_t start = lanes.start(lane);
+
+        // Lanes of the output have the same layout, with `k` rows
+        const R_xlen_t out_start = (lane / lanes.inner) * k * lanes.inner + lane % lanes.inner;
+
+        if (decreasing) {
+          top_k_lane<S, true>(p_x + start, p_values + out_start, p_positions + out_start, lanes.n, k, lanes.inner, lanes.inner, heap);
+        }
+        else {
+          top_k_lane<S, false>(p_x + start, p_values + out_start, p_positions + out_start, lanes.n, k, lanes.inner, lanes.inner, heap);
+        }
+      }
+    });
+  }
+
+  return Rcpp::List::create(
+    Rcpp::Named("values") = values,
+    Rcpp::Named("positions") = positions
+  );
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::List rray__top_k(Rcpp::RObject x, double k, Rcpp::RObject axis, bool decreasing) {
+  if (r_is_null(x)) {
+    return Rcpp::List::create(
+      Rcpp::Named("values") = R_NilValue,
+      Rcpp::Named("positions") = R_NilValue
+    );
+  }
+
+  Rcpp::List out = rray__dispatch_unary(RRAY_LIFT(rray__top_k_impl), x, static_cast<R_xlen_t>(k), axis, decreasing);
+
+  Rcpp::List dim_names = sort_dim_names(rray__dim_names(x), axis);
+
+  Rcpp::RObject values = out["values"];
+  Rcpp::RObject positions = out["positions"];
+
+  rray__set_dim_names(values, dim_names);
+  rray__set_dim_names(positions, dim_names);
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// Positions of the maximum and minimum are found with the reduction engine,
+// so `x` is never copied, whatever the axes. Every cell tracks its best value
+// and the offset of that value in `x`, which is turned into a position at the
+// end. Ties are broken by the smallest offset, so the first extreme value
+// wins, like `which.max()`.
+//
+// With several axes, the position is the one in the sub-array made of the
+// reduced axes, in column major order. Without axes, it is the position in
+// the flattened `x`.
+//
+// With `na_rm`, missing values are skipped, like `which.max()`, and cells
+// with no values left are missing. Otherwise, a missing value results in a
+// missing position.
+
+template <typename S>
+struct rray_arg_extreme {
+  S value;
+  R_xlen_t offset;
+  bool seen;
+  bool na;
+
+  rray_arg_extreme() : value(), offset(0), seen(false), na(false) {}
+};
+
+template <typename S, bool is_max>
+struct rray_arg_extreme_reducer {
+  typedef rray_arg_extreme<S> acc_type;
+
+  const S* p_begin;
+  bool na_rm;
+
+  inline acc_type init() const {
+    return acc_type();
+  }
+
+  inline bool better(S x, R_xlen_t offset, const acc_type& acc) const {
+    if (!acc.seen) {
+      return true;
+    }
+
+    if (x == acc.value) {
+      return offset < acc.offset;
+    }
+
+    return is_max ? x > acc.value : x < acc.value;
+  }
+
+  inline void update(acc_type& acc, S x, R_xlen_t offset) const {
+    if (acc.na) {
+      return;
+    }
+
+    if (rray__is_na(x)) {
+      acc.na = !na_rm;
+      return;
+    }
+
+    if (better(x, offset, acc)) {
+      acc.value = x;
+      acc.offset = offset;
+      acc.seen = true;
+    }
+  }
+
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    const R_xlen_t offset = p_x - p_begin;
+
+    for (R_xlen_t i = 0; i < n && !acc.na; ++i) {
+      update(acc, p_x[i], offset + i);
+    }
+  }
+
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    const R_xlen_t offset = p_x - p_begin;
+
+    for (R_xlen_t i = 0; i < n; ++i) {
+      update(p_acc[i], p_x[i], offset + i);
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    if (other.na) {
+      acc.na = true;
+    }
+    else if (other.seen) {
+      update(acc, other.value, other.offset);
+    }
+  }
+};
+
+template <bool is_max, typename T>
+Rcpp::RObject rray__arg_extreme_impl(const xt::rarray<T>& x,
+                                     Rcpp::RObject axes,
+                                     bool na_rm) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  rray_reduce_plan plan = rray__reduce_plan(dim, axes);
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  rray_arg_extreme_reducer<S, is_max> reducer{p_x, na_rm};
+  std::vector<rray_arg_extreme<S>> cells = rray__reduce(plan, reducer, p_x);
+
+  // Offsets in `x` are converted to positions within the reduced axes. Size
+  // 1 axes are skipped, they are always at position 1.
+  std::vector<R_xlen_t> in_strides, extents, pos_strides;
+
+  R_xlen_t in_stride = 1;
+  R_xlen_t pos_stride = 1;
+
+  for (int i = 0; i < dim.size(); ++i) {
+    if (plan.out_dim[i] != dim[i]) {
+      in_strides.push_back(in_stride);
+      extents.push_back(dim[i]);
+      pos_strides.push_back(pos_stride);
+
+      pos_stride *= dim[i];
+    }
+
+    in_stride *= dim[i];
+  }
+
+  Rcpp::RObject out = Rf_allocVector(INTSXP, plan.out_size);
+  out.attr("dim") = plan.out_dim;
+
+  int* p_out = INTEGER(out);
+
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    const rray_arg_extreme<S>& cell = cells[i];
+
+    if (cell.na || !cell.seen) {
+      p_out[i] = NA_INTEGER;
+      continue;
+    }
+
+    R_xlen_t position = 0;
+
+    for (std::size_t j = 0; j < extents.size(); ++j) {
+      position += (cell.offset / in_strides[j]) % extents[j] * pos_strides[j];
+    }
+
+    p_out[i] = position + 1;
+  }
+
+  return out;
+}
+
+template <typename T>
+Rcpp::RObject rray__max_pos_impl(const xt::rarray<T>& x,
+                                 Rcpp::RObject axes,
+                                 bool na_rm) {
+  return rray__arg_extreme_impl<true>(x, axes, na_rm);
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__max_pos(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+
+  if (r_is_null(x)) {
+    return x;
   }
 
-  std::size_t xt_axis = Rcpp::as<std::size_t>(axis);
-  auto x_argmax = xt::argmin<xt::layout_type::column_major>(x, xt_axis);
-  auto x_reshape = rray__keep_dims_view(x_argmax, dim, axis);
-  xt::rarray<int> out = rray__as_r_idx(x_reshape);
+  Rcpp::RObject out;
+  out = rray__dispatch_unary(RRAY_LIFT(rray__max_pos_impl), x, axes, rray__needs_na_rm(x, na_rm));
 
-  return Rcpp::as<Rcpp::RObject>(out);
+  rray__resize_and_set_dim_names(out, x);
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+template <typename T>
+Rcpp::RObject rray__min_pos_impl(const xt::rarray<T>& x,
+                                 Rcpp::RObject axes,
+                                 bool na_rm) {
+  return rray__arg_extreme_impl<false>(x, axes, na_rm);
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__min_pos(Rcpp::RObject x, Rcpp::RObject axis) {
+Rcpp::RObject rray__min_pos(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
 
   if (r_is_null(x)) {
     return x;
   }
 
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__min_pos_impl, x, axis);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__min_pos_impl), x, axes, rray__needs_na_rm(x, na_rm));
 
   rray__resize_and_set_dim_names(out, x);
 
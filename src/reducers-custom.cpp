@@ -1,223 +1,345 @@
-/*
- * As of xtensor 0.20 some changes to the reducers were made.
- * This broke the xt::reduce() call. Mainly, it broke with an error of
- * "call to binary_functor<double, double>() is ambiguous" and said that
- * both of these were candidate functions:
- *
- * reducers-custom.cpp:78:11: note: candidate function
- * RET_T operator () (const double& x, const ELEM_T& y) const {
- * ^
- * reducers-custom.cpp:82:11: note: candidate function
- * RET_T operator () (const int& x, const ELEM_T& y) const {
- *
- * My implementation isn't the best anyways, so for now I am just going to
- * remove these alltogether as xtensor works out some kinks in their changes
- * and until i can come up with a cleaner implementation generally.
- *
- */
-
-
-// #include <tools/errors.hpp>
-// #include <tools/template-utils.hpp>
-// #include <xtensor/xreducer.hpp>
-// #include <xtensor/xarray.hpp>
-// #include <rray.h>
-// using namespace Rcpp;
-//
-// // How does this work?
-// // 1) rray_custom_reducer_cpp() takes x, a function with 2 args, the axes, and the return type
-// // 2) Based on the types of x and the return type, it calls something along the lines of:
-// //    rray_custom_reducer_impl<TYPEOFX, RETURNTYPE>(x, f, axes);
-// // 3) rray_custom_reducer_impl
-// //    - coerces x to an rarray
-// //    - creates a binary_functor using f and all of the type info
-// //    - then makes an xreducer_functor out of that and calls reduce using it
-// // 4) binary_functor this is where the magic happens
-// //    it lets you use scoping so you can initialize it with "things" you'd like
-// //    it to have available when the function is called (by the overloaded () operator)
-// //    - So we give it the function and the SEXPTYPE return type in the constructor
-// //    - And then we template on the Cpp element and return type
-// //    - Each call to the overloaded () operator calls f and coerces the result
-// //      to RET_T if it can be, otherwise error
-//
-//
-// // Functor allows a kind of scoping so r_functor(left, right)
-// // internally knows about the R function f
-// template <typename ELEM_T, typename RET_T>
-// class binary_functor {
-//
-//   private:
-//     Rcpp::Function f;
-//     SEXPTYPE RTYPE;
-//     R_xlen_t good_length = 1;
-//
-//     template <typename T1, typename T2>
-//     RET_T call_f(const T1& x, const T2& y) const {
-//
-//       SEXP f_res = f(x, y);
-//
-//       // Type check
-//       if (TYPEOF(f_res) != RTYPE) {
-//         const char* good_type = Rf_type2char(RTYPE);
-//         const char* bad_type = Rf_type2char(TYPEOF(f_res));
-//         Rf_errorcall(
-//           R_NilValue,
-//           "`.f` should return length 1 objects of class `%s`, not class `%s`.",
-//           good_type,
-//           bad_type
-//         );
-//       }
-//
-//       // Length check
-//       if (Rf_xlength(f_res) != good_length) {
-//         Rf_errorcall(
-//           R_NilValue,
-//           "`.f` should return objects of length 1, not %i.",
-//           Rf_xlength(f_res)
-//         );
-//       }
-//
-//       // Clever conversion to replace explicit use of
-//       // REAL() or INTEGER()
-//       RET_T res = ((RET_T *)dataptr(f_res))[0];
-//
-//       return(res);
-//
-//     }
-//
-//   public:
-//     binary_functor(Rcpp::Function f_, SEXPTYPE RTYPE_) : f(f_), RTYPE(RTYPE_) {  }
-//
-//     // These control the two possible cases when calling `f` repeatedly
-//     // You could start with a double x, then it could be updated to int x
-//     // and from then on out always be int x. Or vice versa. But this handles
-//     // that flexibility.
-//     RET_T operator () (const double& x, const ELEM_T& y) const {
-//       return call_f<double, ELEM_T>(x, y);
-//     }
-//
-//     RET_T operator () (const int& x, const ELEM_T& y) const {
-//       return call_f<int, ELEM_T>(x, y);
-//     }
-//
-// };
-//
-//
-// template <typename ELEM_R_T, typename RET_R_T>
-// SEXP rray_custom_reducer_impl(SEXP x, Rcpp::Function f, std::vector<std::size_t> axes) {
-//
-//   // Underlying Cpp type. This helper is necessary because it converts
-//   // rlogical->int
-//   using elem_t = typename xt::r_detail::get_underlying_value_type_r<ELEM_R_T>::type;
-//   using ret_t  = typename xt::r_detail::get_underlying_value_type_r<RET_R_T>::type;
-//
-//   // Pull the SEXPTYPE of the return value from the cpp type
-//   // The helper is necessary because rlogical->LGLSXP has been specially registered
-//   static constexpr int ret_sexptype = Rcpp::traits::r_sexptype_traits<RET_R_T>::rtype;
-//
-//   // Create the rarray with the type matching x
-//   const xt::rarray<ELEM_R_T>& x_rray = xt::rarray<ELEM_R_T>(x);
-//
-//   // Create the functor
-//   auto r_functor = binary_functor<elem_t, ret_t>(f, ret_sexptype);
-//   auto xr_functor = xt::make_xreducer_functor(r_functor);
-//
-//   // Temporary solution until xtensor-r#76 is resolved
-//   // Currently it is problematic to assign directly to an rarray from xt::reduce()
-//   // Can't use xarray<RET_R_T> because it doesnt know about rlogical
-//   xt::xarray<ret_t> temp_res = xt::reduce(xr_functor, x_rray, axes);
-//   xt::rarray<RET_R_T> res = temp_res;
-//
-//   return(res);
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// SEXP rray_custom_reducer_cpp(SEXP x, Rcpp::Function f, std::vector<std::size_t> axes, SEXP type_) {
-//
-//   // Collect the char from the string type ("double", "integer", "logical")
-//   const char* type = CHAR(Rf_asChar(type_));
-//
-//   // Switch on X
-//   switch(TYPEOF(x)) {
-//
-//     // This means ELEM_T = double
-//     case REALSXP: {
-//
-//       // Switch on return type:
-//       // "double" = REALSXP
-//       // "integer" = INTSXP
-//       // "logical" = LGLSXP
-//       switch(str2int(type)) {
-//
-//         case str2int("double"): {
-//           return rray_custom_reducer_impl<double, double>(x, f, axes);
-//         }
-//
-//         case str2int("integer"): {
-//           return rray_custom_reducer_impl<double, int>(x, f, axes);
-//         }
-//
-//         case str2int("logical"): {
-//           return rray_custom_reducer_impl<double, rlogical>(x, f, axes);
-//         }
-//
-//         default: {
-//           error_unknown_type();
-//         }
-//
-//       }
-//
-//     }
-//
-//     // This means ELEM_T = int
-//     case INTSXP: {
-//       switch(str2int(type)) {
-//
-//         case str2int("double"): {
-//           return rray_custom_reducer_impl<int, double>(x, f, axes);
-//         }
-//
-//         case str2int("integer"): {
-//           return rray_custom_reducer_impl<int, int>(x, f, axes);
-//         }
-//
-//         case str2int("logical"): {
-//           return rray_custom_reducer_impl<int, rlogical>(x, f, axes);
-//         }
-//
-//         default: {
-//           error_unknown_type();
-//         }
-//
-//       }
-//     }
-//
-//     // This means ELEM_T = int
-//     case LGLSXP: {
-//       switch(str2int(type)) {
-//
-//         case str2int("double"): {
-//           return rray_custom_reducer_impl<rlogical, double>(x, f, axes);
-//         }
-//
-//         case str2int("integer"): {
-//           return rray_custom_reducer_impl<rlogical, int>(x, f, axes);
-//         }
-//
-//         case str2int("logical"): {
-//           return rray_custom_reducer_impl<rlogical, rlogical>(x, f, axes);
-//         }
+#include <rray.h>
+#include <dispatch.h>
+#include <tools/tools.h>
+#include <rray-callable.h>
+#include <R_ext/Rdynload.h>
+
+// -----------------------------------------------------------------------------
+// Custom reducers
 //
-//         default: {
-//           error_unknown_type();
-//         }
+// `rray_reduce()` runs one of a fixed set of native operations through the
+// reduction engine, so a custom reduction is as fast as the built-in
+// reducers. The only exception is a function registered by another package,
+// which is still native code, but is called once per element through a
+// function pointer.
 //
-//       }
-//     }
+// Every operation provides:
 //
-//     default: {
-//       error_unknown_type();
-//     }
+// - `acc_type`, and `init()` returning the identity of the operation.
+// - `update(acc, x)`, reducing the value `x` into `acc`.
+// - `merge(acc, other)`, combining two partial accumulators.
+// - `value(acc)`, the final value of a cell as a double.
 //
-//   }
-// }
+// Elements are always read as doubles, see `rray__as_double()`.
+
+// Keep in sync with `reducer_ops` in R/reducers-custom.R
+enum reducer_op {
+  reducer_sum = 0,
+  reducer_prod = 1,
+  reducer_max = 2,
+  reducer_min = 3,
+  reducer_and = 4,
+  reducer_or = 5,
+  reducer_logsumexp = 6,
+  reducer_count_gt = 7,
+  reducer_count_ge = 8,
+  reducer_count_lt = 9,
+  reducer_count_le = 10,
+  reducer_count_eq = 11,
+  reducer_count_ne = 12,
+  reducer_callable = 13
+};
+
+// -----------------------------------------------------------------------------
+
+struct reducer_sum_op {
+  typedef double acc_type;
+
+  inline acc_type init() const { return 0; }
+  inline void update(acc_type& acc, double x) const { acc += x; }
+  inline void merge(acc_type& acc, const acc_type& other) const { acc += other; }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+struct reducer_prod_op {
+  typedef double acc_type;
+
+  inline acc_type init() const { return 1; }
+  inline void update(acc_type& acc, double x) const { acc *= x; }
+  inline void merge(acc_type& acc, const acc_type& other) const { acc *= other; }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+// The first missing value of a cell sticks
+template <bool is_max>
+struct reducer_extreme_op {
+  typedef double acc_type;
+
+  inline acc_type init() const { return is_max ? R_NegInf : R_PosInf; }
+
+  inline void update(acc_type& acc, double x) const {
+    if (ISNAN(acc)) {
+      return;
+    }
+
+    if (ISNAN(x) || (is_max ? x > acc : x < acc)) {
+      acc = x;
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const { update(acc, other); }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+// Like `all()` and `any()`, a missing value only matters when the result
+// isn't already known. Any value other than `0` counts as `TRUE`.
+template <bool is_any>
+struct reducer_logical_op {
+  typedef double acc_type;
+
+  inline acc_type init() const { return is_any ? 0 : 1; }
+
+  inline void update(acc_type& acc, double x) const {
+    const double known = is_any ? 1 : 0;
+
+    if (acc == known) {
+      return;
+    }
+
+    if (ISNAN(x)) {
+      acc = NA_REAL;
+    }
+    else if ((x != 0) == is_any) {
+      acc = known;
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const { update(acc, other); }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+// `log(sum(exp(x)))` in a single pass, without overflow. The sum is kept
+// relative to the running maximum, and is rescaled whenever a larger value
+// comes along.
+
+struct reducer_lse {
+  double max;
+  double sum;
+};
+
+struct reducer_logsumexp_op {
+  typedef reducer_lse acc_type;
+
+  inline acc_type init() const { return reducer_lse{R_NegInf, 0}; }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    if (ISNAN(acc.max) || other.max == R_NegInf) {
+      return;
+    }
+
+    if (ISNAN(other.max)) {
+      acc.max = other.max;
+      return;
+    }
+
+    if (other.max == acc.max) {
+      acc.sum += other.sum;
+    }
+    else if (other.max < acc.max) {
+      acc.sum += other.sum * std::exp(other.max - acc.max);
+    }
+    else {
+      acc.sum = acc.sum * std::exp(acc.max - other.max) + other.sum;
+      acc.max = other.max;
+    }
+  }
+
+  inline void update(acc_type& acc, double x) const { merge(acc, reducer_lse{x, 1}); }
+
+  inline double value(const acc_type& acc) const {
+    return (acc.max == R_NegInf) ? R_NegInf : acc.max + std::log(acc.sum);
+  }
+};
+
+// Counts the values that compare to `threshold`. A missing value results in
+// a missing count, like `sum(x > threshold)`.
+template <class Compare>
+struct reducer_count_op {
+  typedef double acc_type;
+
+  double threshold;
+
+  inline acc_type init() const { return 0; }
+
+  inline void update(acc_type& acc, double x) const {
+    acc += ISNAN(x) ? NA_REAL : static_cast<double>(Compare()(x, threshold));
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const { acc += other; }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+// A function registered by another package, see inst/include/rray-callable.h
+struct reducer_callable_op {
+  typedef double acc_type;
+
+  rray_reduce_fn fn;
+  double initial;
+
+  inline acc_type init() const { return initial; }
+  inline void update(acc_type& acc, double x) const { acc = fn(acc, x); }
+  inline void merge(acc_type& acc, const acc_type& other) const { acc = fn(acc, other); }
+  inline double value(const acc_type& acc) const { return acc; }
+};
+
+// -----------------------------------------------------------------------------
+
+// Adapts an operation to the interface of `rray__reduce()`, see
+// inst/include/tools/reduce.h. With `na_rm`, missing values are skipped
+// before they reach the operation.
+
+template <class Op>
+struct rray_custom_reducer {
+  typedef typename Op::acc_type acc_type;
+
+  Op op;
+  bool na_rm;
+
+  inline acc_type init() const {
+    return op.init();
+  }
+
+  template <typename S>
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      const double x = rray__as_double(p_x[i]);
+
+      if (na_rm && ISNAN(x)) {
+        continue;
+      }
+
+      op.update(acc, x);
+    }
+  }
+
+  template <typename S>
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      const double x = rray__as_double(p_x[i]);
+
+      if (na_rm && ISNAN(x)) {
+        continue;
+      }
+
+      op.update(p_acc[i], x);
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    op.merge(acc, other);
+  }
+};
+
+template <class Op, typename S>
+Rcpp::RObject rray__reduce_custom_run(const rray_reduce_plan& plan,
+                                      const S* p_x,
+                                      Op op,
+                                      SEXPTYPE out_type,
+                                      bool na_rm) {
+
+  std::vector<typename Op::acc_type> cells = rray__reduce(plan, rray_custom_reducer<Op>{op, na_rm}, p_x);
+
+  Rcpp::RObject out = Rf_allocVector(out_type, plan.out_size);
+  out.attr("dim") = plan.out_dim;
+
+  if (out_type == REALSXP) {
+    double* p_out = REAL(out);
+
+    for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+      p_out[i] = op.value(cells[i]);
+    }
+  }
+  else {
+    int* p_out = LOGICAL(out);
+
+    for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+      const double value = op.value(cells[i]);
+      p_out[i] = ISNAN(value) ? NA_LOGICAL : static_cast<int>(value);
+    }
+  }
+
+  return out;
+}
+
+template <typename T>
+Rcpp::RObject rray__reduce_custom_impl(const xt::rarray<T>& x,
+                                       Rcpp::RObject axes,
+                                       int op,
+                                       double threshold,
+                                       rray_reduce_fn fn,
+                                       double init,
+                                       bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  switch (op) {
+  case reducer_sum: return rray__reduce_custom_run(plan, p_x, reducer_sum_op(), REALSXP, na_rm);
+  case reducer_prod: return rray__reduce_custom_run(plan, p_x, reducer_prod_op(), REALSXP, na_rm);
+  case reducer_max: return rray__reduce_custom_run(plan, p_x, reducer_extreme_op<true>(), REALSXP, na_rm);
+  case reducer_min: return rray__reduce_custom_run(plan, p_x, reducer_extreme_op<false>(), REALSXP, na_rm);
+  case reducer_and: return rray__reduce_custom_run(plan, p_x, reducer_logical_op<false>(), LGLSXP, na_rm);
+  case reducer_or: return rray__reduce_custom_run(plan, p_x, reducer_logical_op<true>(), LGLSXP, na_rm);
+  case reducer_logsumexp: return rray__reduce_custom_run(plan, p_x, reducer_logsumexp_op(), REALSXP, na_rm);
+  case reducer_count_gt: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::greater<double>>{threshold}, REALSXP, na_rm);
+  case reducer_count_ge: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::greater_equal<double>>{threshold}, REALSXP, na_rm);
+  case reducer_count_lt: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::less<double>>{threshold}, REALSXP, na_rm);
+  case reducer_count_le: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::less_equal<double>>{threshold}, REALSXP, na_rm);
+  case reducer_count_eq: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::equal_to<double>>{threshold}, REALSXP, na_rm);
+  case reducer_count_ne: return rray__reduce_custom_run(plan, p_x, reducer_count_op<std::not_equal_to<double>>{threshold}, REALSXP, na_rm);
+  case reducer_callable: return rray__reduce_custom_run(plan, p_x, reducer_callable_op{fn, init}, REALSXP, na_rm);
+  default: Rcpp::stop("Internal error: Unknown reducer %i.", op);
+  }
+}
+
+// `callable` is `NULL`, or the package and name a function was registered
+// under with `R_RegisterCCallable()`
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__reduce_custom(Rcpp::RObject x,
+                                  Rcpp::RObject axes,
+                                  int op,
+                                  double threshold,
+                                  Rcpp::RObject callable,
+                                  double init,
+                                  bool na_rm) {
+
+  rray_reduce_fn fn = NULL;
+
+  if (op == reducer_callable) {
+    const char* package = CHAR(STRING_ELT(callable, 0));
+    const char* name = CHAR(STRING_ELT(callable, 1));
+
+    // Errors when `package` is not loaded, or didn't register `name`
+    fn = (rray_reduce_fn) R_GetCCallable(package, name);
+  }
+
+  if (r_is_null(x)) {
+    return x;
+  }
+
+  na_rm = rray__needs_na_rm(x, na_rm);
+
+  Rcpp::RObject out;
+  out = rray__dispatch_unary(
+    RRAY_LIFT(rray__reduce_custom_impl), x, axes, op, threshold, fn, init, na_rm
+  );
+
+  rray__resize_and_set_dim_names(out, x);
+
+  return out;
+}
+
+// -----------------------------------------------------------------------------
+
+// Test only. A plain sum, so the callable reducers can be tested without
+// another package. It is only registered when the tests ask for it.
+
+static double rray_test_sum(double acc, double x) {
+  return acc + x;
+}
+
+// [[Rcpp::export(rng = false)]]
+void rray__test_register_callable() {
+  R_RegisterCCallable("rray", "rray_test_sum", (DL_FUNC) &rray_test_sum);
+}
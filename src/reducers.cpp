@@ -2,244 +2,899 @@
 #include <dispatch.h>
 #include <tools/tools.h>
 
-// Required for xt::evaluation_strategy::immediate
-#include <xtensor/xarray.hpp>
-
 // -----------------------------------------------------------------------------
 
-#define DISPATCH_REDUCER(FUN, X, AXES)                         \
+#define DISPATCH_REDUCER(FUN, X, ...)                          \
   if (r_is_null(X)) {                                          \
     return X;                                                  \
   }                                                            \
                                                                \
   Rcpp::RObject out;                                           \
-  DISPATCH_UNARY_ONE(out, FUN, X, AXES);                       \
+  out = rray__dispatch_unary(RRAY_LIFT(FUN), X, __VA_ARGS__);  \
                                                                \
   rray__resize_and_set_dim_names(out, X);                      \
                                                                \
   return out
 
-#define REDUCER_IMPL(FUN, X, AXES)                                            \
-  if (r_is_null(AXES)) {                                                      \
-    return FUN(X, xt::keep_dims | xt::evaluation_strategy::immediate);        \
-  }                                                                           \
-                                                                              \
-  using size_vec = typename std::vector<std::size_t>;                         \
-  size_vec xt_axes = Rcpp::as<size_vec>(AXES);                                \
-                                                                              \
-  return FUN(X, xt_axes, xt::keep_dims | xt::evaluation_strategy::immediate)
-
 // -----------------------------------------------------------------------------
 
-// guard against integer overflow
+// Sums are accumulated into one `rray_neumaier` per output cell. Runs that
+// are reduced into a single cell are summed pairwise first (or with
+// compensation at every step, when `compensated` is set). Otherwise, each
+// cell accumulates up to `rray_pairwise_block` elements naively before they
+// are added to its compensated total.
+//
+// With `na_rm`, missing values are skipped, and counted in `n_na` so that
+// means can be computed over the remaining values.
+
+struct rray_sum_acc {
+  double partial;
+  R_xlen_t count;
+  R_xlen_t n_na;
+  rray_neumaier total;
+
+  rray_sum_acc() : partial(0), count(0), n_na(0) {}
+
+  inline double value() const {
+    rray_neumaier out = total;
+    out.add(partial);
+    return out.value();
+  }
+};
+
+struct rray_sum_reducer {
+  typedef rray_sum_acc acc_type;
+
+  bool compensated;
+  bool na_rm;
+
+  inline acc_type init() const {
+    return acc_type();
+  }
+
+  template <typename S>
+  inline double sum(const S* p_x, R_xlen_t n) const {
+    return compensated ? rray__compensated_sum(p_x, n) : rray__pairwise_sum(p_x, n);
+  }
+
+  template <typename S>
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    if (!na_rm) {
+      acc.total.add(sum(p_x, n));
+      return;
+    }
+
+    acc.n_na += rray__for_each_non_na(p_x, n, [&](const S* p_values, R_xlen_t n_values) {
+      acc.total.add(sum(p_values, n_values));
+    });
+  }
+
+  template <typename S>
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    const R_xlen_t block = compensated ? 1 : rray_pairwise_block;
+
+    for (R_xlen_t i = 0; i < n; ++i) {
+      acc_type& acc = p_acc[i];
+      const double x = rray__as_double(p_x[i]);
+
+      if (na_rm && ISNAN(x)) {
+        acc.n_na++;
+        continue;
+      }
+
+      acc.partial += x;
+
+      if (++acc.count == block) {
+        acc.total.add(acc.partial);
+        acc.partial = 0;
+        acc.count = 0;
+      }
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    acc.total.add(other.value());
+    acc.n_na += other.n_na;
+  }
+};
 
 template <typename T>
-xt::rarray<double> rray__sum_impl(const xt::rarray<T>& x, Rcpp::RObject axes) {
-  REDUCER_IMPL(xt::sum, x, axes);
+Rcpp::RObject rray__sum_impl(const xt::rarray<T>& x,
+                             Rcpp::RObject axes,
+                             bool compensated,
+                             bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  std::vector<rray_sum_acc> cells = rray__reduce(plan, rray_sum_reducer{compensated, na_rm}, p_x);
+
+  Rcpp::RObject out = rray__reduce_out(plan, 0);
+  double* p_out = REAL(out);
+
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    p_out[i] = cells[i].value();
+  }
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__sum(Rcpp::RObject x, Rcpp::RObject axes) {
-  DISPATCH_REDUCER(rray__sum_impl, x, axes);
+Rcpp::RObject rray__sum(Rcpp::RObject x,
+                        Rcpp::RObject axes,
+                        bool compensated,
+                        bool na_rm) {
+  DISPATCH_REDUCER(rray__sum_impl, x, axes, compensated, rray__needs_na_rm(x, na_rm));
 }
 
 // -----------------------------------------------------------------------------
 
+struct rray_prod_reducer {
+  typedef double acc_type;
+
+  bool na_rm;
+
+  inline acc_type init() const {
+    return 1;
+  }
+
+  // Missing values are removed by multiplying by 1 instead
+  inline double value(double x) const {
+    return (na_rm && ISNAN(x)) ? 1 : x;
+  }
+
+  template <typename S>
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      acc *= value(rray__as_double(p_x[i]));
+    }
+  }
+
+  template <typename S>
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_acc[i] *= value(rray__as_double(p_x[i]));
+    }
+  }
+
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    acc *= other;
+  }
+};
+
 template <typename T>
-xt::rarray<double> rray__prod_impl(const xt::rarray<T>& x, Rcpp::RObject axes) {
-  REDUCER_IMPL(xt::prod, x, axes);
+Rcpp::RObject rray__prod_impl(const xt::rarray<T>& x,
+                              Rcpp::RObject axes,
+                              bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  std::vector<double> cells = rray__reduce(plan, rray_prod_reducer{na_rm}, p_x);
+
+  Rcpp::RObject out = rray__reduce_out(plan, 0);
+  std::copy(cells.begin(), cells.end(), REAL(out));
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__prod(Rcpp::RObject x, Rcpp::RObject axes) {
-  DISPATCH_REDUCER(rray__prod_impl, x, axes);
+Rcpp::RObject rray__prod(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+  DISPATCH_REDUCER(rray__prod_impl, x, axes, rray__needs_na_rm(x, na_rm));
 }
 
 // -----------------------------------------------------------------------------
 
 template <typename T>
-xt::rarray<double> rray__mean_impl(const xt::rarray<T>& x, Rcpp::RObject axes) {
-  REDUCER_IMPL(xt::mean, x, axes);
+Rcpp::RObject rray__mean_impl(const xt::rarray<T>& x,
+                              Rcpp::RObject axes,
+                              bool compensated,
+                              bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  std::vector<rray_sum_acc> cells = rray__reduce(plan, rray_sum_reducer{compensated, na_rm}, p_x);
+
+  // Every cell is reduced over the same number of elements
+  const R_xlen_t n = (plan.out_size == 0) ? 0 : plan.size / plan.out_size;
+
+  Rcpp::RObject out = rray__reduce_out(plan, 0);
+  double* p_out = REAL(out);
+
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    p_out[i] = cells[i].value() / static_cast<double>(n - cells[i].n_na);
+  }
+
+  return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__mean(Rcpp::RObject x, Rcpp::RObject axes) {
-  DISPATCH_REDUCER(rray__mean_impl, x, axes);
+Rcpp::RObject rray__mean(Rcpp::RObject x,
+                         Rcpp::RObject axes,
+                         bool compensated,
+                         bool na_rm) {
+  DISPATCH_REDUCER(rray__mean_impl, x, axes, compensated, rray__needs_na_rm(x, na_rm));
 }
 
 // -----------------------------------------------------------------------------
 
-// TODO - Blocked by
-// https://github.com/r-lib/rray/issues/42
+// Variance and standard deviation are computed in a single pass over `x`.
+// Runs that are reduced into one cell are processed in blocks small enough
+// to stay in cache. Each block's mean and sum of squared deviations are
+// computed exactly with two passes over the block, and merged into the cell
+// with the pairwise update of Chan et al. Otherwise, every element updates
+// its cell with Welford's algorithm.
 
-// template <typename T>
-// xt::rarray<double> rray__variance_impl(const xt::rarray<T>& x, Rcpp::RObject axes) {
-//
-//   if (r_is_null(axes)) {
-//     return xt::variance(x, xt::keep_dims);
-//   }
-//
-//   using size_vec = typename std::vector<std::size_t>;
-//   size_vec xt_axes = Rcpp::as<size_vec>(axes);
-//
-//   return xt::variance(x, xt_axes, xt::keep_dims);
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// Rcpp::RObject rray__variance(Rcpp::RObject x, Rcpp::RObject axes) {
-//   DISPATCH_UNARY_ONE(rray__variance_impl, x, axes);
-// }
+static const R_xlen_t moments_block_size = 4096;
 
-// -----------------------------------------------------------------------------
+struct rray_moments {
+  double n;
+  double mean;
+  double m2;
 
-// TODO - Blocked by
-// https://github.com/r-lib/rray/issues/42
+  rray_moments() : n(0), mean(0), m2(0) {}
+};
 
-// template <typename T>
-// xt::rarray<double> rray__std_dev_impl(const xt::rarray<T>& x, Rcpp::RObject axes) {
-//
-//   if (r_is_null(axes)) {
-//     return xt::stddev(x, xt::keep_dims);
-//   }
-//
-//   using size_vec = typename std::vector<std::size_t>;
-//   size_vec xt_axes = Rcpp::as<size_vec>(axes);
-//
-//   return xt::stddev(x, xt_axes, xt::keep_dims);
-// }
-//
-// // [[Rcpp::export(rng = false)]]
-// Rcpp::RObject rray__std_dev(Rcpp::RObject x, Rcpp::RObject axes) {
-//   DISPATCH_UNARY_ONE(rray__std_dev_impl, x, axes);
-// }
+struct rray_moments_reducer {
+  typedef rray_moments acc_type;
 
-// -----------------------------------------------------------------------------
+  bool na_rm;
 
-// Documentation for `infinite_check()` and `infinite_output()`:
-// - `infinite_check()` checks to see if `rray_max()` or `rray_min()` are
-// going to return infinite values based on `x`'s dimensions combined with
-// the `axes` we are reducing over.
-// - `infinite_output()` constructs the correct Inf/-Inf output if `infinite_check()`
-// returned true.
-// - When would this happen? Consider:
-// (0, 1) -> (1, 1)
-// rray_max(matrix(numeric(), 0, 1), 1)
-// A value has to be filled in, and base R chooses -Inf: max(), but xtensor
-// uses the lowest finite value of type T. So we get around this by returning
-// our own value if we detect this case. On the other hand, this is fine
-// and no special handling is needed by us.
-// (0, 1) -> (0, 1)
-// rray_max(matrix(numeric(), 0, 1), 2)
+  inline acc_type init() const {
+    return acc_type();
+  }
 
-template <typename T>
-bool infinite_check(const xt::rarray<T>& x,
-                    Rcpp::Nullable<Rcpp::IntegerVector> axes) {
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    if (other.n == 0) {
+      return;
+    }
 
-  bool is_infinite = false;
-  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
-  Rcpp::IntegerVector r_axes;
+    const double n = acc.n + other.n;
+    const double delta = other.mean - acc.mean;
+
+    acc.mean += delta * other.n / n;
+    acc.m2 += other.m2 + delta * delta * acc.n * other.n / n;
+    acc.n = n;
+  }
+
+  template <typename S>
+  inline void run_values(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t start = 0; start < n; start += moments_block_size) {
+      const S* p_block = p_x + start;
+
+      acc_type block;
+      block.n = std::min(moments_block_size, n - start);
+
+      double sum = 0;
+      for (R_xlen_t i = 0; i < block.n; ++i) {
+        sum += rray__as_double(p_block[i]);
+      }
+      block.mean = sum / block.n;
+
+      for (R_xlen_t i = 0; i < block.n; ++i) {
+        const double delta = rray__as_double(p_block[i]) - block.mean;
+        block.m2 += delta * delta;
+      }
+
+      merge(acc, block);
+    }
+  }
+
+  template <typename S>
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    if (!na_rm) {
+      run_values(acc, p_x, n);
+      return;
+    }
 
-  if (axes.isNull()) {
-    r_axes = Rcpp::seq_along(dim) - 1;
+    rray__for_each_non_na(p_x, n, [&](const S* p_values, R_xlen_t n_values) {
+      run_values(acc, p_values, n_values);
+    });
   }
-  else {
-    r_axes = axes;
+
+  template <typename S>
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      acc_type& acc = p_acc[i];
+      const double x = rray__as_double(p_x[i]);
+
+      if (na_rm && ISNAN(x)) {
+        continue;
+      }
+
+      acc.n += 1;
+
+      const double delta = x - acc.mean;
+      acc.mean += delta / acc.n;
+      acc.m2 += delta * (x - acc.mean);
+    }
   }
+};
+
+template <typename T>
+Rcpp::RObject rray__moments_impl(const xt::rarray<T>& x,
+                                 Rcpp::RObject axes,
+                                 bool std_dev,
+                                 bool na_rm) {
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const auto* p_x = rray_storage<T>::ptr(SEXP(x));
 
-  for (int axis : r_axes) {
-    if (dim[axis] == 0) {
-      is_infinite = true;
-      break;
+  std::vector<rray_moments> cells = rray__reduce(plan, rray_moments_reducer{na_rm}, p_x);
+
+  Rcpp::RObject out = rray__reduce_out(plan, NA_REAL);
+  double* p_out = REAL(out);
+
+  // Like `var()`, at least 2 values are required
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    if (cells[i].n < 2) {
+      continue;
     }
+
+    const double var = cells[i].m2 / (cells[i].n - 1);
+    p_out[i] = std_dev ? std::sqrt(var) : var;
   }
 
-  return is_infinite;
+  return out;
+}
+
+template <typename T>
+Rcpp::RObject rray__var_impl(const xt::rarray<T>& x, Rcpp::RObject axes, bool na_rm) {
+  return rray__moments_impl(x, axes, false, na_rm);
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__var(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+  DISPATCH_REDUCER(rray__var_impl, x, axes, rray__needs_na_rm(x, na_rm));
 }
 
+// -----------------------------------------------------------------------------
+
 template <typename T>
-Rcpp::RObject infinite_output(const xt::rarray<T>& x,
-                              Rcpp::Nullable<Rcpp::IntegerVector> axes,
-                              bool is_max) {
+Rcpp::RObject rray__sd_impl(const xt::rarray<T>& x, Rcpp::RObject axes, bool na_rm) {
+  return rray__moments_impl(x, axes, true, na_rm);
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__sd(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+  DISPATCH_REDUCER(rray__sd_impl, x, axes, rray__needs_na_rm(x, na_rm));
+}
+
+// -----------------------------------------------------------------------------
+
+// The maximum and minimum keep the type of `x`. Like `max()` and `min()`,
+// a missing value anywhere along the reduced axes results in a missing value.
+// With `na_rm`, missing values are skipped instead.
+//
+// A cell can be left with nothing to reduce, when the reduced axes have a
+// size of 0, or when `na_rm` skipped all of its values. Like base R, its
+// maximum is `-Inf` and its minimum is `Inf`, see `rray__extreme_out()`.
+// Reducing `matrix(numeric(), 0, 1)` over the 2nd axis has no cells at all,
+// and simply returns an empty result.
 
-  Rcpp::IntegerVector dim = Rcpp::clone(rray__dim(SEXP(x)));
-  Rcpp::IntegerVector r_axes;
+template <typename S>
+struct rray_extreme {
+  S value;
+  bool seen;
+  bool na;
 
-  if (axes.isNull()) {
-    r_axes = Rcpp::seq_along(dim) - 1;
+  rray_extreme() : value(), seen(false), na(false) {}
+};
+
+template <typename S, bool is_max>
+struct rray_extreme_reducer {
+  typedef rray_extreme<S> acc_type;
+
+  bool na_rm;
+
+  inline acc_type init() const {
+    return acc_type();
   }
-  else {
-    r_axes = axes;
+
+  inline void update(acc_type& acc, S x) const {
+    if (acc.na) {
+      return;
+    }
+
+    if (rray__is_na(x)) {
+      if (na_rm) {
+        return;
+      }
+
+      acc.value = x;
+      acc.na = true;
+      return;
+    }
+
+    if (!acc.seen || (is_max ? x > acc.value : x < acc.value)) {
+      acc.value = x;
+      acc.seen = true;
+    }
   }
 
-  for (int axis : r_axes) {
-    dim[axis] = 1;
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n && !acc.na; ++i) {
+      update(acc, p_x[i]);
+    }
   }
 
-  xt::rarray<double> xt_inf = is_max ? R_NegInf : R_PosInf;
-  xt::rarray<double> xt_inf_out = xt::broadcast(xt_inf, dim);
-  Rcpp::RObject inf_out = SEXP(xt_inf_out);
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      update(p_acc[i], p_x[i]);
+    }
+  }
 
-  return inf_out;
-}
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    if (other.seen || other.na) {
+      update(acc, other.value);
+    }
+  }
+};
 
-template <typename T>
-Rcpp::RObject rray__max_impl(const xt::rarray<T>& x,
-                             Rcpp::Nullable<Rcpp::IntegerVector> axes) {
+// Like `max()` and `min()`, cells where nothing was left to reduce, because
+// the axes are empty or `na.rm` removed every value, are `-Inf` or `Inf`.
+// These can't be stored in an integer, so the result is then a double, and
+// integers and logicals warn about the change of type like base R does.
+
+template <typename T, typename S = typename rray_storage<T>::type>
+Rcpp::RObject rray__extreme_out(const rray_reduce_plan& plan,
+                                const std::vector<rray_extreme<S>>& cells,
+                                bool is_max) {
+  bool any_empty = false;
 
-  if (infinite_check(x, axes)) {
-    return infinite_output(x, axes, true);
+  for (R_xlen_t i = 0; i < plan.out_size && !any_empty; ++i) {
+    any_empty = !cells[i].seen && !cells[i].na;
   }
 
-  if (r_is_null(axes)) {
-    xt::rarray<T> xt_out = xt::amax(x, xt::keep_dims | xt::evaluation_strategy::immediate);
-    Rcpp::RObject out = SEXP(xt_out);
+  if (any_empty) {
+    if (rray_storage<T>::sexptype != REALSXP) {
+      Rcpp::warning(
+        "no non-missing arguments to %s; returning %s",
+        is_max ? "max" : "min",
+        is_max ? "-Inf" : "Inf"
+      );
+    }
+
+    Rcpp::RObject out = rray__reduce_out(plan, is_max ? R_NegInf : R_PosInf);
+    double* p_out = REAL(out);
+
+    for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+      if (cells[i].seen || cells[i].na) {
+        p_out[i] = rray__as_double(cells[i].value);
+      }
+    }
+
     return out;
   }
 
-  using size_vec = typename std::vector<std::size_t>;
-  size_vec xt_axes = Rcpp::as<size_vec>(axes);
+  Rcpp::RObject out = Rf_allocVector(rray_storage<T>::sexptype, plan.out_size);
+  out.attr("dim") = plan.out_dim;
 
-  xt::rarray<T> xt_out = xt::amax(x, xt_axes, xt::keep_dims | xt::evaluation_strategy::immediate);
-  Rcpp::RObject out = SEXP(xt_out);
+  S* p_out = rray_storage<T>::ptr(out);
+
+  for (R_xlen_t i = 0; i < plan.out_size; ++i) {
+    p_out[i] = cells[i].value;
+  }
 
   return out;
 }
 
+template <bool is_max, typename T>
+Rcpp::RObject rray__extreme_impl(const xt::rarray<T>& x,
+                                 Rcpp::RObject axes,
+                                 bool na_rm) {
+  typedef typename rray_storage<T>::type S;
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  std::vector<rray_extreme<S>> cells = rray__reduce(plan, rray_extreme_reducer<S, is_max>{na_rm}, p_x);
+
+  return rray__extreme_out<T>(plan, cells, is_max);
+}
+
+template <typename T>
+Rcpp::RObject rray__max_impl(const xt::rarray<T>& x, Rcpp::RObject axes, bool na_rm) {
+  return rray__extreme_impl<true>(x, axes, na_rm);
+}
+
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__max(Rcpp::RObject x,
-                        Rcpp::Nullable<Rcpp::IntegerVector> axes) {
-  DISPATCH_REDUCER(rray__max_impl, x, axes);
+Rcpp::RObject rray__max(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+  DISPATCH_REDUCER(rray__max_impl, x, axes, rray__needs_na_rm(x, na_rm));
 }
 
 // -----------------------------------------------------------------------------
 
 template <typename T>
-Rcpp::RObject rray__min_impl(const xt::rarray<T>& x,
-                             Rcpp::Nullable<Rcpp::IntegerVector> axes) {
+Rcpp::RObject rray__min_impl(const xt::rarray<T>& x, Rcpp::RObject axes, bool na_rm) {
+  return rray__extreme_impl<false>(x, axes, na_rm);
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__min(Rcpp::RObject x, Rcpp::RObject axes, bool na_rm) {
+  DISPATCH_REDUCER(rray__min_impl, x, axes, rray__needs_na_rm(x, na_rm));
+}
+
+// -----------------------------------------------------------------------------
 
-  if (infinite_check(x, axes)) {
-    return infinite_output(x, axes, false);
+// `rray_summarise()` computes several statistics in a single pass over `x`.
+// Every requested statistic is updated one block at a time, so each block
+// of `x` is only read from memory once, and stays in cache while the
+// other statistics are updated.
+
+static const R_xlen_t summary_block_size = 2048;
+
+template <typename S>
+struct rray_summary {
+  rray_sum_acc sum;
+  rray_moments moments;
+  rray_extreme<S> min;
+  rray_extreme<S> max;
+};
+
+template <typename S>
+struct rray_summary_reducer {
+  typedef rray_summary<S> acc_type;
+
+  bool do_sum = false;
+  bool do_moments = false;
+  bool do_min = false;
+  bool do_max = false;
+
+  rray_sum_reducer sum_reducer;
+  rray_moments_reducer moments_reducer;
+  rray_extreme_reducer<S, false> min_reducer;
+  rray_extreme_reducer<S, true> max_reducer;
+
+  rray_summary_reducer(bool na_rm) :
+    sum_reducer{false, na_rm},
+    moments_reducer{na_rm},
+    min_reducer{na_rm},
+    max_reducer{na_rm} {}
+
+  inline acc_type init() const {
+    return acc_type();
   }
 
-  if (r_is_null(axes)) {
-    xt::rarray<T> xt_out = xt::amin(x, xt::keep_dims | xt::evaluation_strategy::immediate);
-    Rcpp::RObject out = SEXP(xt_out);
-    return out;
+  inline void run(acc_type& acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t start = 0; start < n; start += summary_block_size) {
+      const S* p_block = p_x + start;
+      const R_xlen_t size = std::min(summary_block_size, n - start);
+
+      if (do_sum) sum_reducer.run(acc.sum, p_block, size);
+      if (do_moments) moments_reducer.run(acc.moments, p_block, size);
+      if (do_min) min_reducer.run(acc.min, p_block, size);
+      if (do_max) max_reducer.run(acc.max, p_block, size);
+    }
+  }
+
+  inline void step(acc_type* p_acc, const S* p_x, R_xlen_t n) const {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      acc_type& acc = p_acc[i];
+
+      if (do_sum) sum_reducer.step(&acc.sum, p_x + i, 1);
+      if (do_moments) moments_reducer.step(&acc.moments, p_x + i, 1);
+      if (do_min) min_reducer.update(acc.min, p_x[i]);
+      if (do_max) max_reducer.update(acc.max, p_x[i]);
+    }
   }
 
-  using size_vec = typename std::vector<std::size_t>;
-  size_vec xt_axes = Rcpp::as<size_vec>(axes);
+  inline void merge(acc_type& acc, const acc_type& other) const {
+    if (do_sum) sum_reducer.merge(acc.sum, other.sum);
+    if (do_moments) moments_reducer.merge(acc.moments, other.moments);
+    if (do_min) min_reducer.merge(acc.min, other.min);
+    if (do_max) max_reducer.merge(acc.max, other.max);
+  }
+};
 
-  xt::rarray<T> xt_out = xt::amin(x, xt_axes, xt::keep_dims | xt::evaluation_strategy::immediate);
-  Rcpp::RObject out = SEXP(xt_out);
+template <typename T>
+Rcpp::RObject rray__summarise_impl(const xt::rarray<T>& x,
+                                   Rcpp::RObject axes,
+                                   Rcpp::CharacterVector stats,
+                                   bool na_rm) {
+
+  typedef typename rray_storage<T>::type S;
+
+  const int n_stats = stats.size();
+  std::vector<std::string> names(n_stats);
+
+  rray_summary_reducer<S> reducer(na_rm);
+
+  for (int i = 0; i < n_stats; ++i) {
+    names[i] = Rcpp::as<std::string>(stats[i]);
+    const std::string& stat = names[i];
+
+    if (stat == "sum" || stat == "mean") {
+      reducer.do_sum = true;
+    }
+    else if (stat == "var" || stat == "sd") {
+      reducer.do_moments = true;
+    }
+    else if (stat == "min") {
+      reducer.do_min = true;
+    }
+    else if (stat == "max") {
+      reducer.do_max = true;
+    }
+    else if (stat == "count") {
+      // Missing values are counted along with the sums
+      reducer.do_sum = reducer.do_sum || na_rm;
+    }
+    else {
+      Rcpp::stop("Internal error: Unknown statistic '%s'.", stat);
+    }
+  }
+
+  rray_reduce_plan plan = rray__reduce_plan(rray__dim(SEXP(x)), axes);
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  std::vector<rray_summary<S>> cells = rray__reduce(plan, reducer, p_x);
+
+  // Every cell is reduced over the same number of elements
+  const double n = (plan.out_size == 0) ? 0 : plan.size / plan.out_size;
+
+  Rcpp::List out(n_stats);
+
+  for (int i = 0; i < n_stats; ++i) {
+    const std::string& stat = names[i];
+    Rcpp::RObject elt;
+
+    if (stat == "min" || stat == "max") {
+      const bool is_max = stat == "max";
+
+      std::vector<rray_extreme<S>> extremes(plan.out_size);
+
+      for (R_xlen_t j = 0; j < plan.out_size; ++j) {
+        extremes[j] = is_max ? cells[j].max : cells[j].min;
+      }
+
+      elt = rray__extreme_out<T>(plan, extremes, is_max);
+    }
+    else if (stat == "count") {
+      elt = rray__reduce_out(plan, n);
+      double* p_elt = REAL(elt);
+
+      if (reducer.do_sum) {
+        for (R_xlen_t j = 0; j < plan.out_size; ++j) {
+          p_elt[j] -= cells[j].sum.n_na;
+        }
+      }
+    }
+    else {
+      elt = rray__reduce_out(plan, NA_REAL);
+      double* p_elt = REAL(elt);
+
+      if (stat == "sum") {
+        for (R_xlen_t j = 0; j < plan.out_size; ++j) {
+          p_elt[j] = cells[j].sum.value();
+        }
+      }
+      else if (stat == "mean") {
+        for (R_xlen_t j = 0; j < plan.out_size; ++j) {
+          p_elt[j] = cells[j].sum.value() / (n - cells[j].sum.n_na);
+        }
+      }
+      else {
+        const bool std_dev = stat == "sd";
+
+        for (R_xlen_t j = 0; j < plan.out_size; ++j) {
+          const rray_moments& moments = cells[j].moments;
+
+          if (moments.n < 2) {
+            continue;
+          }
+
+          const double var = moments.m2 / (moments.n - 1);
+          p_elt[j] = std_dev ? std::sqrt(var) : var;
+        }
+      }
+    }
+
+    out[i] = elt;
+  }
+
+  out.names() = stats;
 
   return out;
 }
 
 // [[Rcpp::export(rng = false)]]
-Rcpp::RObject rray__min(Rcpp::RObject x,
-                        Rcpp::Nullable<Rcpp::IntegerVector> axes) {
-  DISPATCH_REDUCER(rray__min_impl, x, axes);
+Rcpp::List rray__summarise(Rcpp::RObject x,
+                           Rcpp::RObject axes,
+                           Rcpp::CharacterVector stats,
+                           bool na_rm) {
+
+  if (r_is_null(x)) {
+    Rcpp::List out(stats.size());
+    out.names() = stats;
+    return out;
+  }
+
+  na_rm = rray__needs_na_rm(x, na_rm);
+
+  Rcpp::List out = rray__dispatch_unary(RRAY_LIFT(rray__summarise_impl), x, axes, stats, na_rm);
+
+  if (out.size() == 0) {
+    return out;
+  }
+
+  // All statistics share the same dimensions, so the dimension names are
+  // only resized once
+  Rcpp::RObject first = out[0];
+  rray__resize_and_set_dim_names(first, x);
+
+  Rcpp::RObject dim_names = first.attr("dimnames");
+
+  for (R_xlen_t i = 1; i < out.size(); ++i) {
+    Rcpp::RObject elt = out[i];
+    elt.attr("dimnames") = dim_names;
+  }
+
+  return out;
 }
 
 // -----------------------------------------------------------------------------
+
+// Quantiles are computed one output cell at a time. The values reduced into
+// a cell are gathered into a scratch buffer owned by the thread, and the
+// order statistics that are needed are selected in place with
+// `std::nth_element()`, rather than fully sorting the buffer. Probabilities
+// are handled in increasing order, so that every selection only has to
+// look at the values above the previous one.
+//
+// Like `quantile(type = 7)`, each quantile interpolates between the two
+// order statistics surrounding `(n - 1) * prob`. Cells with a missing
+// value, or without any value, are missing.
+//
+// With `probs_axis`, the quantiles are laid out along a new last axis,
+// otherwise there must be a single probability.
+
+static void rray__quantile_cell(double* p_values,
+                                R_xlen_t n,
+                                const std::vector<double>& probs,
+                                const std::vector<int>& order,
+                                double* p_out,
+                                R_xlen_t out_size) {
+
+  // All values before `selected` are smaller than the ones after it
+  R_xlen_t selected = -1;
+
+  for (int j : order) {
+    const double index = (n - 1) * probs[j];
+    const R_xlen_t lo = static_cast<R_xlen_t>(std::floor(index));
+    const double h = index - lo;
+
+    if (lo > selected) {
+      std::nth_element(p_values + selected + 1, p_values + lo, p_values + n);
+      selected = lo;
+    }
+
+    double value = p_values[lo];
+
+    if (h > 0) {
+      const double hi = *std::min_element(p_values + lo + 1, p_values + n);
+
+      if (hi != value) {
+        value = (1 - h) * value + h * hi;
+      }
+    }
+
+    p_out[j * out_size] = value;
+  }
+}
+
+template <typename T>
+Rcpp::RObject rray__quantile_impl(const xt::rarray<T>& x,
+                                  Rcpp::RObject axes,
+                                  const std::vector<double>& probs,
+                                  bool probs_axis,
+                                  bool na_rm) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  rray_reduce_plan plan = rray__reduce_plan(dim, axes);
+
+  const int n_probs = probs.size();
+
+  Rcpp::IntegerVector out_dim = plan.out_dim;
+
+  if (probs_axis) {
+    out_dim.push_back(n_probs);
+  }
+
+  Rcpp::RObject out = Rf_allocVector(REALSXP, plan.out_size * n_probs);
+  out.attr("dim") = out_dim;
+
+  double* p_out = REAL(out);
+  std::fill(p_out, p_out + plan.out_size * n_probs, NA_REAL);
+
+  if (plan.out_size == 0) {
+    return out;
+  }
+
+  // Walk the kept and reduced axes of `x` separately. Size 1 axes are
+  // skipped, they don't move the offsets.
+  std::vector<R_xlen_t> kept_dim, kept_strides;
+  std::vector<R_xlen_t> reduced_dim, reduced_strides;
+
+  R_xlen_t stride = 1;
+
+  for (int i = 0; i < dim.size(); ++i) {
+    if (plan.out_dim[i] != dim[i]) {
+      reduced_dim.push_back(dim[i]);
+      reduced_strides.push_back(stride);
+    }
+    else if (dim[i] != 1) {
+      kept_dim.push_back(dim[i]);
+      kept_strides.push_back(stride);
+    }
+
+    stride *= dim[i];
+  }
+
+  const R_xlen_t n = plan.size / plan.out_size;
+
+  std::vector<int> order(n_probs);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](int i, int j) {
+    return probs[i] < probs[j];
+  });
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  const int n_threads = std::min<R_xlen_t>(rray__threads_for(plan.size), plan.out_size);
+
+  rray__parallel_each(n_threads, [&](int thread) {
+    const R_xlen_t cell_begin = plan.out_size * thread / n_threads;
+    const R_xlen_t cell_end = plan.out_size * (thread + 1) / n_threads;
+
+    std::vector<double> scratch(n);
+
+    rray_odometer kept(kept_dim, kept_strides, kept_strides);
+    rray_odometer reduced(reduced_dim, reduced_strides, reduced_strides);
+
+    kept.seek(cell_begin);
+
+    for (R_xlen_t cell = cell_begin; cell < cell_end; ++cell) {
+      R_xlen_t n_values = 0;
+      bool any_na = false;
+
+      reduced.seek(0);
+
+      for (R_xlen_t i = 0; i < n; ++i) {
+        const double value = rray__as_double(p_x[kept.offset_a + reduced.offset_a]);
+
+        scratch[n_values] = value;
+        n_values += !ISNAN(value);
+        any_na = any_na || ISNAN(value);
+
+        reduced.next();
+      }
+
+      if (n_values > 0 && (na_rm || !any_na)) {
+        rray__quantile_cell(scratch.data(), n_values, probs, order, p_out + cell, plan.out_size);
+      }
+
+      kept.next();
+    }
+  });
+
+  return out;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__quantile(Rcpp::RObject x,
+                             Rcpp::RObject axes,
+                             std::vector<double> probs,
+                             bool probs_axis,
+                             bool na_rm) {
+
+  if (!probs_axis && probs.size() != 1) {
+    Rcpp::stop("Internal error: Exactly one probability is required without `probs_axis`.");
+  }
+
+  DISPATCH_REDUCER(rray__quantile_impl, x, axes, probs, probs_axis, rray__needs_na_rm(x, na_rm));
+}
@@ -0,0 +1,329 @@
+#include <rray.h>
+#include <dispatch.h>
+#include <tools/tools.h>
+
+// -----------------------------------------------------------------------------
+// Rolling reducers
+//
+// Like the accumulators, `x` is seen as `outer` slabs of `n` rows of `inner`
+// contiguous elements, where `n` is the size of `axis`. Every lane along
+// `axis` is rolled over in a single forward pass:
+//
+// - Sums and means keep a running, compensated sum of the window. The value
+//   that leaves the window is subtracted as the new one comes in. Missing
+//   and infinite values are counted instead of summed, so that they can
+//   leave the window again.
+//
+// - Maxima and minima keep a monotonic deque of the values that can still
+//   become the extreme of a later window, so every value is pushed and
+//   popped at most once.
+//
+// Lanes are processed in tiles of `roll_tile_size` adjacent lanes, so that
+// each row of a tile is read as a contiguous run even when `axis` isn't the
+// first axis. Tiles are split across threads.
+//
+// The result has the shape of `x`. Each window is aligned with its last
+// element, and the first `width - 1` elements of every lane are missing.
+
+// Keep in sync with `roll_ops` in R/rolling.R
+enum roll_op {
+  roll_sum = 0,
+  roll_mean = 1,
+  roll_max = 2,
+  roll_min = 3
+};
+
+static const R_xlen_t roll_tile_size = 64;
+
+// -----------------------------------------------------------------------------
+
+struct roll_sum_state {
+  rray_neumaier sum;
+  R_xlen_t n_na;
+  R_xlen_t n_pos_inf;
+  R_xlen_t n_neg_inf;
+
+  roll_sum_state() : n_na(0), n_pos_inf(0), n_neg_inf(0) {}
+
+  inline void update(double x, int sign) {
+    if (ISNAN(x)) {
+      n_na += sign;
+    }
+    else if (x == R_PosInf) {
+      n_pos_inf += sign;
+    }
+    else if (x == R_NegInf) {
+      n_neg_inf += sign;
+    }
+    else {
+      sum.add(sign * x);
+    }
+  }
+
+  inline double value() const {
+    if (n_na > 0) {
+      return NA_REAL;
+    }
+
+    if (n_pos_inf > 0) {
+      return (n_neg_inf > 0) ? R_NaN : R_PosInf;
+    }
+
+    if (n_neg_inf > 0) {
+      return R_NegInf;
+    }
+
+    return sum.value();
+  }
+};
+
+template <typename S>
+static void roll_sum_tile(const S* p_x,
+                          double* p_out,
+                          R_xlen_t inner,
+                          R_xlen_t n,
+                          R_xlen_t n_lanes,
+                          R_xlen_t width,
+                          bool mean) {
+
+  roll_sum_state states[roll_tile_size];
+
+  for (R_xlen_t k = 0; k < n; ++k) {
+    const S* p_row = p_x + k * inner;
+    double* p_out_row = p_out + k * inner;
+
+    for (R_xlen_t i = 0; i < n_lanes; ++i) {
+      roll_sum_state& state = states[i];
+
+      state.update(rray__as_double(p_row[i]), 1);
+
+      // The value that leaves the window
+      if (k >= width) {
+        state.update(rray__as_double(p_x[(k - width) * inner + i]), -1);
+      }
+
+      if (k < width - 1) {
+        p_out_row[i] = NA_REAL;
+        continue;
+      }
+
+      const double value = state.value();
+      p_out_row[i] = mean ? value / width : value;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// A ring buffer of the positions and values that can still become the
+// extreme of a window, from oldest to newest. Values are monotonic from the
+// front to the back, so the front is always the extreme of the window.
+
+template <typename S>
+struct roll_deque {
+  R_xlen_t* p_pos;
+  S* p_value;
+  R_xlen_t capacity;
+  R_xlen_t front;
+  R_xlen_t size;
+
+  inline R_xlen_t slot(R_xlen_t i) const {
+    return (front + i) % capacity;
+  }
+};
+
+template <typename S, bool is_max>
+static void roll_extreme_tile(const S* p_x,
+                              S* p_out,
+                              R_xlen_t inner,
+                              R_xlen_t n,
+                              R_xlen_t n_lanes,
+                              R_xlen_t width,
+                              std::vector<R_xlen_t>& pos_buffer,
+                              std::vector<S>& value_buffer) {
+
+  const R_xlen_t capacity = std::min(width, n);
+
+  roll_deque<S> deques[roll_tile_size];
+  R_xlen_t last_na[roll_tile_size];
+
+  for (R_xlen_t i = 0; i < n_lanes; ++i) {
+    deques[i] = roll_deque<S>{
+      pos_buffer.data() + i * capacity,
+      value_buffer.data() + i * capacity,
+      capacity,
+      0,
+      0
+    };
+
+    last_na[i] = -1;
+  }
+
+  for (R_xlen_t k = 0; k < n; ++k) {
+    const S* p_row = p_x + k * inner;
+    S* p_out_row = p_out + k * inner;
+
+    for (R_xlen_t i = 0; i < n_lanes; ++i) {
+      roll_deque<S>& deque = deques[i];
+      const S x = p_row[i];
+
+      // Drop the position that left the window
+      if (deque.size > 0 && deque.p_pos[deque.front] <= k - width) {
+        deque.front = deque.slot(1);
+        deque.size--;
+      }
+
+      // Missing values aren't pushed, they make every window they are in
+      // missing
+      if (rray__is_na(x)) {
+        last_na[i] = k;
+      }
+      else {
+        while (deque.size > 0) {
+          const S back = deque.p_value[deque.slot(deque.size - 1)];
+
+          if (is_max ? back > x : back < x) {
+            break;
+          }
+
+          deque.size--;
+        }
+
+        const R_xlen_t back = deque.slot(deque.size);
+        deque.p_pos[back] = k;
+        deque.p_value[back] = x;
+        deque.size++;
+      }
+
+      if (k < width - 1) {
+        p_out_row[i] = rray__na<S>();
+        continue;
+      }
+
+      if (last_na[i] > k - width) {
+        p_out_row[i] = rray__na<S>();
+        continue;
+      }
+
+      p_out_row[i] = deque.p_value[deque.front];
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+
+// Calls `f(p_x, p_out, n_lanes)` on every tile, with pointers to the first
+// element of the tile
+template <typename S, typename R, class F>
+static void roll_tiles(const S* p_x,
+                       R* p_out,
+                       R_xlen_t inner,
+                       R_xlen_t n,
+                       R_xlen_t outer,
+                       F f) {
+
+  const R_xlen_t n_tiles_slab = (inner + roll_tile_size - 1) / roll_tile_size;
+  const R_xlen_t n_tiles = n_tiles_slab * outer;
+
+  const int n_threads = std::min<R_xlen_t>(rray__threads_for(inner * n * outer), n_tiles);
+
+  rray__parallel_each(n_threads, [&](int thread) {
+    const R_xlen_t tile_begin = n_tiles * thread / n_threads;
+    const R_xlen_t tile_end = n_tiles * (thread + 1) / n_threads;
+
+    for (R_xlen_t tile = tile_begin; tile < tile_end; ++tile) {
+      const R_xlen_t slab = tile / n_tiles_slab;
+      const R_xlen_t lane = (tile % n_tiles_slab) * roll_tile_size;
+      const R_xlen_t n_lanes = std::min(roll_tile_size, inner - lane);
+
+      const R_xlen_t offset = slab * n * inner + lane;
+
+      f(p_x + offset, p_out + offset, n_lanes);
+    }
+  });
+}
+
+template <typename T>
+Rcpp::RObject rray__roll_impl(const xt::rarray<T>& x,
+                              R_xlen_t width,
+                              int axis,
+                              int op) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector dim = rray__dim(SEXP(x));
+  const R_xlen_t size = rray__dim_size(dim);
+
+  R_xlen_t inner = 1;
+  R_xlen_t outer = 1;
+
+  for (int i = 0; i < axis; ++i) {
+    inner *= dim[i];
+  }
+
+  const R_xlen_t n = dim[axis];
+
+  for (int i = axis + 1; i < dim.size(); ++i) {
+    outer *= dim[i];
+  }
+
+  const S* p_x = rray_storage<T>::ptr(SEXP(x));
+
+  const bool is_extreme = op == roll_max || op == roll_min;
+
+  Rcpp::RObject out = Rf_allocVector(is_extreme ? rray_storage<T>::sexptype : REALSXP, size);
+  out.attr("dim") = dim;
+
+  if (size == 0) {
+    return out;
+  }
+
+  if (!is_extreme) {
+    const bool mean = op == roll_mean;
+
+    roll_tiles(p_x, REAL(out), inner, n, outer, [&](const S* p_tile, double* p_out_tile, R_xlen_t n_lanes) {
+      roll_sum_tile(p_tile, p_out_tile, inner, n, n_lanes, width, mean);
+    });
+
+    return out;
+  }
+
+  const R_xlen_t capacity = std::min(width, n);
+  S* p_out = rray_storage<T>::ptr(out);
+
+  roll_tiles(p_x, p_out, inner, n, outer, [&](const S* p_tile, S* p_out_tile, R_xlen_t n_lanes) {
+    // Scratch space for the deques of a tile
+    std::vector<R_xlen_t> pos_buffer(n_lanes * capacity);
+    std::vector<S> value_buffer(n_lanes * capacity);
+
+    if (op == roll_max) {
+      roll_extreme_tile<S, true>(p_tile, p_out_tile, inner, n, n_lanes, width, pos_buffer, value_buffer);
+    }
+    else {
+      roll_extreme_tile<S, false>(p_tile, p_out_tile, inner, n, n_lanes, width, pos_buffer, value_buffer);
+    }
+  });
+
+  return out;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__roll(Rcpp::RObject x, double width, int axis, int op) {
+
+  if (op < roll_sum || op > roll_min) {
+    Rcpp::stop("Internal error: Unknown rolling reducer %i.", op);
+  }
+
+  if (r_is_null(x)) {
+    return x;
+  }
+
+  Rcpp::RObject out;
+  out = rray__dispatch_unary(RRAY_LIFT(rray__roll_impl), x, static_cast<R_xlen_t>(width), axis, op);
+
+  // Windows are aligned with their last element, so the names of every
+  // axis still apply
+  rray__resize_and_set_dim_names(out, x);
+
+  return out;
+}
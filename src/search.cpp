@@ -0,0 +1,198 @@
+#include <rray.h>
+#include <dispatch.h>
+#include <tools/tools.h>
+
+// -----------------------------------------------------------------------------
+// Binary search
+//
+// `sorted` holds lanes of breakpoints along `axis`. Collapsing `axis` to a
+// single element gives the shape of the lanes themselves, which is
+// broadcast against `values` with the usual rules. Every element of the
+// result is the number of breakpoints of its lane that are smaller than its
+// value (`side = "left"`), or smaller than or equal to it (`side =
+// "right"`), so it is also where the value would be inserted.
+//
+// The searches are branch-free: every step halves the range with a
+// conditional move instead of a branch, so the number of steps only
+// depends on the size of `axis`. Since that size is the same for every
+// lane, searches are run in batches of `search_batch_size` values that step
+// through the breakpoints in lockstep, letting the loads of the whole batch
+// overlap.
+//
+// Missing values result in a missing position. `sorted` must be sorted in
+// increasing order without missing values, which isn't checked.
+
+static const int search_batch_size = 8;
+
+template <typename S, bool right>
+struct rray_search_before {
+  // Does `breakpoint` come before the insertion point of `value`?
+  inline bool operator()(S breakpoint, S value) const {
+    return right ? !(value < breakpoint) : breakpoint < value;
+  }
+};
+
+template <typename S, bool right>
+static void search_batch(const S* p_sorted,
+                         const R_xlen_t* p_lanes,
+                         const S* p_values,
+                         int* p_out,
+                         int n_batch,
+                         R_xlen_t n,
+                         R_xlen_t stride) {
+
+  const rray_search_before<S, right> before;
+
+  if (n == 0) {
+    std::fill(p_out, p_out + n_batch, 0);
+    return;
+  }
+
+  R_xlen_t base[search_batch_size] = {};
+  R_xlen_t len = n;
+
+  while (len > 1) {
+    const R_xlen_t half = len / 2;
+
+    for (int b = 0; b < n_batch; ++b) {
+      const S breakpoint = p_sorted[p_lanes[b] + (base[b] + half) * stride];
+      base[b] = before(breakpoint, p_values[b]) ? base[b] + half : base[b];
+    }
+
+    len -= half;
+  }
+
+  for (int b = 0; b < n_batch; ++b) {
+    const S breakpoint = p_sorted[p_lanes[b] + base[b] * stride];
+    p_out[b] = base[b] + before(breakpoint, p_values[b]);
+  }
+}
+
+template <typename T>
+Rcpp::RObject rray__search_sorted_impl(const xt::rarray<T>& sorted,
+                                       const xt::rarray<T>& values,
+                                       int axis,
+                                       bool right) {
+
+  typedef typename rray_storage<T>::type S;
+
+  Rcpp::IntegerVector sorted_dim = rray__dim(SEXP(sorted));
+  Rcpp::IntegerVector values_dim = rray__dim(SEXP(values));
+
+  const int dim_n = std::max(sorted_dim.size(), values_dim.size());
+  sorted_dim = rray__increase_dims(sorted_dim, dim_n);
+
+  Rcpp::IntegerVector lane_dim = Rcpp::clone(sorted_dim);
+  lane_dim[axis] = 1;
+
+  Rcpp::IntegerVector dim = rray__dim2(lane_dim, values_dim);
+  const R_xlen_t size = rray__dim_size(dim);
+
+  // Strides of the start of the lanes of `sorted` in the result. The result
+  // doesn't move along the lanes, so `axis` has a stride of 0.
+  std::vector<R_xlen_t> lane_strides(dim_n);
+  R_xlen_t stride = 1;
+  R_xlen_t axis_stride = 1;
+
+  for (int i = 0; i < dim_n; ++i) {
+    if (i == axis) {
+      axis_stride = stride;
+    }
+
+    lane_strides[i] = (i == axis || sorted_dim[i] == 1) ? 0 : stride;
+    stride *= sorted_dim[i];
+  }
+
+  const R_xlen_t n = sorted_dim[axis];
+
+  Rcpp::RObject out = Rf_allocVector(INTSXP, size);
+  out.attr("dim") = dim;
+
+  const S* p_sorted = rray_storage<T>::ptr(SEXP(sorted));
+  const S* p_values = rray_storage<T>::ptr(SEXP(values));
+  int* p_out = INTEGER(out);
+
+  const std::vector<R_xlen_t> outer_dim(dim.begin(), dim.end());
+  const std::vector<R_xlen_t> values_strides = rray__broadcast_strides(SEXP(values), dim);
+
+  if (size == 0) {
+    return out;
+  }
+
+  rray__parallel_for(size, [&](R_xlen_t begin, R_xlen_t end) {
+    rray_odometer odometer(outer_dim, lane_strides, values_strides);
+    odometer.seek(begin);
+
+    R_xlen_t lanes[search_batch_size];
+    S batch[search_batch_size];
+    R_xlen_t positions[search_batch_size];
+    int results[search_batch_size];
+    int n_batch = 0;
+
+    auto flush = [&]() {
+      if (right) {
+        search_batch<S, true>(p_sorted, lanes, batch, results, n_batch, n, axis_stride);
+      }
+      else {
+        search_batch<S, false>(p_sorted, lanes, batch, results, n_batch, n, axis_stride);
+      }
+
+      for (int b = 0; b < n_batch; ++b) {
+        p_out[positions[b]] = results[b];
+      }
+
+      n_batch = 0;
+    };
+
+    // Missing values are written directly, the others are searched for in
+    // batches
+    for (R_xlen_t i = begin; i < end; ++i, odometer.next()) {
+      const S value = p_values[odometer.offset_b];
+
+      if (rray__is_na(value)) {
+        p_out[i] = NA_INTEGER;
+        continue;
+      }
+
+      lanes[n_batch] = odometer.offset_a;
+      batch[n_batch] = value;
+      positions[n_batch] = i;
+      n_batch++;
+
+      if (n_batch == search_batch_size) {
+        flush();
+      }
+    }
+
+    if (n_batch > 0) {
+      flush();
+    }
+  });
+
+  return out;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__search_sorted(Rcpp::RObject sorted,
+                                  Rcpp::RObject values,
+                                  int axis,
+                                  bool right) {
+
+  Rcpp::RObject out;
+  out = rray__dispatch_binary(RRAY_LIFT(rray__search_sorted_impl), sorted, values, axis, right);
+
+  // Names along `axis` belong to the breakpoints, not to the result
+  Rcpp::List sorted_dim_names = Rf_shallow_duplicate(rray__dim_names(sorted));
+  sorted_dim_names[axis] = R_NilValue;
+
+  Rcpp::IntegerVector dim = rray__dim(out);
+
+  Rcpp::List dim_names = rray__coalesce_dim_names(
+    rray__resize_dim_names(sorted_dim_names, dim),
+    rray__resize_dim_names(rray__dim_names(values), dim)
+  );
+
+  rray__set_dim_names(out, dim_names);
+
+  return out;
+}
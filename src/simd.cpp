@@ -0,0 +1,56 @@
+#include <tools/simd.h>
+
+// -----------------------------------------------------------------------------
+// Definitions initialized in rray_init_simd()
+
+rray_simd rray_simd_level = rray_simd_baseline;
+
+// -----------------------------------------------------------------------------
+
+static rray_simd rray_detect_simd() {
+#ifdef RRAY_SIMD_DISPATCH
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return rray_simd_avx512;
+  }
+
+  if (__builtin_cpu_supports("avx2")) {
+    return rray_simd_avx2;
+  }
+#endif
+
+  return rray_simd_baseline;
+}
+
+// The level can be lowered with the `RRAY_SIMD` environment variable, which
+// is useful for comparing the different versions of the kernels.
+// It is never raised above what the CPU supports.
+
+void rray_init_simd(SEXP ns) {
+  rray_simd level = rray_detect_simd();
+
+  const char* env = std::getenv("RRAY_SIMD");
+
+  if (env != NULL) {
+    std::string requested(env);
+
+    if (requested == "baseline") {
+      level = rray_simd_baseline;
+    }
+    else if (requested == "avx2") {
+      level = std::min(level, rray_simd_avx2);
+    }
+  }
+
+  rray_simd_level = level;
+}
+
+// [[Rcpp::export(rng = false)]]
+std::string rray__simd() {
+  switch (rray_simd_level) {
+  case rray_simd_avx512: return "avx512";
+  case rray_simd_avx2: return "avx2";
+  default: return "baseline";
+  }
+}
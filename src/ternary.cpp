@@ -0,0 +1,353 @@
+#include <rray.h>
+#include <dispatch.h>
+#include <type2.h>
+#include <cast.h>
+#include <utils.h>
+
+// -----------------------------------------------------------------------------
+// Fused ternary operations
+//
+// `x`, `y` and `z` are read with their own inner type, and broadcast through
+// a stride of 0 along the axes where they have a size of 1. The result is
+// computed one block at a time. Inputs that already have the type and size
+// of the result are read in place, the others are converted and gathered
+// into a small buffer that stays in cache, so no intermediate arrays are
+// ever allocated.
+
+// Keep in sync with `ternary_ops` in R/ternary.R
+enum ternary_op {
+  ternary_fma = 0,
+  ternary_lerp = 1,
+  ternary_clamp = 2
+};
+
+static const R_xlen_t ternary_block_size = 1024;
+
+// -----------------------------------------------------------------------------
+
+// Everything the worker threads need to know about an input, resolved up
+// front so they never touch the R API
+
+struct ternary_input {
+  SEXPTYPE type;
+  const void* p_x;
+  R_xlen_t size;
+  std::vector<R_xlen_t> strides;
+};
+
+static ternary_input ternary_input_init(SEXP x, const Rcpp::IntegerVector& dim) {
+  const SEXPTYPE type = TYPEOF(x);
+  const void* p_x;
+
+  switch (type) {
+  case REALSXP: p_x = REAL(x); break;
+  case INTSXP: p_x = INTEGER(x); break;
+  case LGLSXP: p_x = LOGICAL(x); break;
+  default: error_unknown_type();
+  }
+
+  return ternary_input{type, p_x, Rf_xlength(x), rray__broadcast_strides(x, dim)};
+}
+
+// Logicals and integers share the same storage and missing value
+
+template <typename C>
+static inline C ternary_convert(int value);
+
+template <>
+inline double ternary_convert<double>(int value) {
+  return (value == NA_INTEGER) ? NA_REAL : static_cast<double>(value);
+}
+
+template <>
+inline int ternary_convert<int>(int value) {
+  return value;
+}
+
+template <typename C>
+static inline C ternary_convert(double value) {
+  return static_cast<C>(value);
+}
+
+// Copy the elements of `input` that correspond to the result positions
+// `[start, start + n)` into `p_out`, converting them to `C` on the way
+
+template <typename C, typename S>
+static void ternary_gather(const ternary_input& input,
+                           const std::vector<R_xlen_t>& dim,
+                           R_xlen_t size,
+                           R_xlen_t start,
+                           R_xlen_t n,
+                           C* p_out) {
+
+  const S* p_x = static_cast<const S*>(input.p_x);
+
+  if (input.size == size) {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_out[i] = ternary_convert<C>(p_x[start + i]);
+    }
+    return;
+  }
+
+  if (input.size == 1) {
+    std::fill(p_out, p_out + n, ternary_convert<C>(p_x[0]));
+    return;
+  }
+
+  const int dim_n = dim.size();
+  std::vector<R_xlen_t> idx(dim_n);
+
+  // Locate `start` in the result and in `input`
+  R_xlen_t rem = start;
+  R_xlen_t offset = 0;
+
+  for (int j = 0; j < dim_n; ++j) {
+    idx[j] = rem % dim[j];
+    rem = rem / dim[j];
+    offset += idx[j] * input.strides[j];
+  }
+
+  for (R_xlen_t i = 0; i < n; ++i) {
+    p_out[i] = ternary_convert<C>(p_x[offset]);
+
+    for (int j = 0; j < dim_n; ++j) {
+      idx[j]++;
+      offset += input.strides[j];
+
+      if (idx[j] < dim[j]) {
+        break;
+      }
+
+      offset -= idx[j] * input.strides[j];
+      idx[j] = 0;
+    }
+  }
+}
+
+// Returns a pointer to the block of `input` starting at `start`. Reads
+// straight from `input` when possible, otherwise gathers into `buffer`.
+
+template <typename C>
+static const C* ternary_block(const ternary_input& input,
+                              const std::vector<R_xlen_t>& dim,
+                              R_xlen_t size,
+                              R_xlen_t start,
+                              R_xlen_t n,
+                              C* buffer) {
+
+  const bool is_double = input.type == REALSXP;
+  const bool is_compute_type = std::is_same<C, double>::value == is_double;
+
+  if (is_compute_type && input.size == size) {
+    return static_cast<const C*>(input.p_x) + start;
+  }
+
+  if (is_double) {
+    ternary_gather<C, double>(input, dim, size, start, n, buffer);
+  }
+  else {
+    ternary_gather<C, int>(input, dim, size, start, n, buffer);
+  }
+
+  return buffer;
+}
+
+// -----------------------------------------------------------------------------
+
+static void ternary_apply(int op,
+                          double* p_out,
+                          const double* p_x,
+                          const double* p_y,
+                          const double* p_z,
+                          R_xlen_t n,
+                          std::atomic<bool>& overflow) {
+  switch (op) {
+  case ternary_fma: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_out[i] = std::fma(p_x[i], p_y[i], p_z[i]);
+    }
+    break;
+  }
+  case ternary_lerp: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      p_out[i] = p_x[i] + p_z[i] * (p_y[i] - p_x[i]);
+    }
+    break;
+  }
+  case ternary_clamp: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      bool any_nan = ISNAN(p_x[i]) || ISNAN(p_y[i]) || ISNAN(p_z[i]);
+      p_out[i] = any_nan ? p_x[i] + p_y[i] + p_z[i] : std::min(std::max(p_x[i], p_y[i]), p_z[i]);
+    }
+    break;
+  }
+  }
+}
+
+// Integers are checked for overflow, see `rray__int_checked()`
+
+static void ternary_apply(int op,
+                          int* p_out,
+                          const int* p_x,
+                          const int* p_y,
+                          const int* p_z,
+                          R_xlen_t n,
+                          std::atomic<bool>& overflow) {
+  switch (op) {
+  case ternary_fma: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      bool any_na = (p_x[i] == NA_INTEGER) || (p_y[i] == NA_INTEGER) || (p_z[i] == NA_INTEGER);
+      p_out[i] = rray__int_checked(static_cast<int64_t>(p_x[i]) * p_y[i] + p_z[i], any_na, overflow);
+    }
+    break;
+  }
+  case ternary_clamp: {
+    for (R_xlen_t i = 0; i < n; ++i) {
+      bool any_na = (p_x[i] == NA_INTEGER) || (p_y[i] == NA_INTEGER) || (p_z[i] == NA_INTEGER);
+      p_out[i] = any_na ? NA_INTEGER : std::min(std::max(p_x[i], p_y[i]), p_z[i]);
+    }
+    break;
+  }
+  }
+}
+
+template <typename C>
+static void ternary_loop(int op,
+                         C* p_out,
+                         const ternary_input& x,
+                         const ternary_input& y,
+                         const ternary_input& z,
+                         const std::vector<R_xlen_t>& dim,
+                         R_xlen_t size,
+                         std::atomic<bool>& overflow) {
+
+  rray__parallel_for(size, [&](R_xlen_t begin, R_xlen_t end) {
+    std::vector<C> x_buffer(ternary_block_size);
+    std::vector<C> y_buffer(ternary_block_size);
+    std::vector<C> z_buffer(ternary_block_size);
+
+    for (R_xlen_t start = begin; start < end; start += ternary_block_size) {
+      R_xlen_t n = std::min(ternary_block_size, end - start);
+
+      const C* p_x = ternary_block(x, dim, size, start, n, x_buffer.data());
+      const C* p_y = ternary_block(y, dim, size, start, n, y_buffer.data());
+      const C* p_z = ternary_block(z, dim, size, start, n, z_buffer.data());
+
+      ternary_apply(op, p_out + start, p_x, p_y, p_z, n, overflow);
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+
+// Dimension names are only resized and coalesced when at least one of the
+// inputs has any
+static bool ternary_has_names(SEXP x) {
+  return !r_is_null(Rf_getAttrib(x, R_DimNamesSymbol)) ||
+    !r_is_null(Rf_getAttrib(x, R_NamesSymbol));
+}
+
+static Rcpp::List ternary_dim_names(Rcpp::RObject x,
+                                    Rcpp::RObject y,
+                                    Rcpp::RObject z,
+                                    const Rcpp::IntegerVector& dim) {
+
+  Rcpp::List new_dim_names = rray__resize_dim_names(rray__dim_names(x), dim);
+
+  new_dim_names = rray__coalesce_dim_names(
+    new_dim_names,
+    rray__resize_dim_names(rray__dim_names(y), dim)
+  );
+
+  new_dim_names = rray__coalesce_dim_names(
+    new_dim_names,
+    rray__resize_dim_names(rray__dim_names(z), dim)
+  );
+
+  return new_dim_names;
+}
+
+// The result type of `op`. Integer arithmetic is computed in double
+// precision when `as_double` is set.
+
+static SEXPTYPE ternary_out_type(int op, SEXPTYPE type, bool as_double) {
+  if (type == REALSXP || as_double || op == ternary_lerp) {
+    return REALSXP;
+  }
+
+  // Logicals are computed as integers, clamping doesn't leave the range
+  // of the inputs so it can keep them as logicals
+  if (type == LGLSXP && op != ternary_clamp) {
+    return INTSXP;
+  }
+
+  return type;
+}
+
+// [[Rcpp::export(rng = false)]]
+Rcpp::RObject rray__ternary(Rcpp::RObject x,
+                            Rcpp::RObject y,
+                            Rcpp::RObject z,
+                            int op,
+                            bool as_double) {
+
+  if (op < ternary_fma || op > ternary_clamp) {
+    Rcpp::stop("Internal error: Unknown ternary operation %i.", op);
+  }
+
+  SEXPTYPE x_type = rray_native_inner_type(x);
+  SEXPTYPE y_type = rray_native_inner_type(y);
+  SEXPTYPE z_type = rray_native_inner_type(z);
+
+  // Anything other than bare logicals, integers and doubles goes through
+  // the usual vctrs casting
+  if (x_type == NILSXP || y_type == NILSXP || z_type == NILSXP) {
+    Rcpp::RObject type = vec__ptype_inner2(vec__ptype_inner2(x, y), z);
+
+    x = vec__cast_inner(x, type);
+    y = vec__cast_inner(y, type);
+    z = vec__cast_inner(z, type);
+
+    if (r_is_null(x) || r_is_null(y) || r_is_null(z)) {
+      return R_NilValue;
+    }
+
+    x_type = TYPEOF(type);
+    y_type = x_type;
+    z_type = x_type;
+  }
+
+  const SEXPTYPE type = std::max(x_type, std::max(y_type, z_type));
+  const SEXPTYPE out_type = ternary_out_type(op, type, as_double);
+
+  Rcpp::IntegerVector dim = rray__dim2(rray__dim2(rray__dim(x), rray__dim(y)), rray__dim(z));
+  R_xlen_t size = rray__dim_size(dim);
+
+  ternary_input x_input = ternary_input_init(x, dim);
+  ternary_input y_input = ternary_input_init(y, dim);
+  ternary_input z_input = ternary_input_init(z, dim);
+
+  Rcpp::RObject out = Rf_allocVector(out_type, size);
+  out.attr("dim") = dim;
+
+  // Read by the worker threads
+  std::vector<R_xlen_t> loop_dim(dim.begin(), dim.end());
+
+  std::atomic<bool> overflow(false);
+
+  if (out_type == REALSXP) {
+    ternary_loop(op, REAL(out), x_input, y_input, z_input, loop_dim, size, overflow);
+  }
+  else {
+    int* p_out = (out_type == INTSXP) ? INTEGER(out) : LOGICAL(out);
+    ternary_loop(op, p_out, x_input, y_input, z_input, loop_dim, size, overflow);
+  }
+
+  rray__warn_int_overflow(overflow);
+
+  if (ternary_has_names(x) || ternary_has_names(y) || ternary_has_names(z)) {
+    rray__set_dim_names(out, ternary_dim_names(x, y, z, dim));
+  }
+
+  return out;
+}
@@ -1,9 +1,12 @@
 #include <utils.h>
 #include <type2.h>
+#include <r-api.h>
 
 SEXP fns_vec_ptype_inner2 = NULL;
 
-SEXP vec__ptype_inner2(SEXP x, SEXP y) {
+// -----------------------------------------------------------------------------
+
+static SEXP vec__ptype_inner2_r(SEXP x, SEXP y) {
   SEXP env = PROTECT(r_new_environment(rray_ns_env, 2));
 
   Rf_defineVar(syms_x, x, env);
@@ -17,6 +20,29 @@ SEXP vec__ptype_inner2(SEXP x, SEXP y) {
   return res;
 }
 
+// The common inner type of logicals, integers, doubles, and rrays of those
+// types is computed natively and returned as one of the shared empty
+// vectors. `NULL` is the identity element, like with `vec_ptype2()`.
+
+SEXP vec__ptype_inner2(SEXP x, SEXP y) {
+  bool x_null = r_is_null(x);
+  bool y_null = r_is_null(y);
+
+  if (x_null && y_null) {
+    return R_NilValue;
+  }
+
+  SEXPTYPE x_type = x_null ? NILSXP : rray_native_inner_type(x);
+  SEXPTYPE y_type = y_null ? NILSXP : rray_native_inner_type(y);
+
+  if ((x_type == NILSXP && !x_null) || (y_type == NILSXP && !y_null)) {
+    return vec__ptype_inner2_r(x, y);
+  }
+
+  // SEXPTYPEs are ordered as LGLSXP < INTSXP < REALSXP, and NILSXP is 0
+  return rray_shared_empty(std::max(x_type, y_type));
+}
+
 void rray_init_type2(SEXP ns) {
   fns_vec_ptype_inner2 = Rf_install("vec_ptype_inner2");
 }
@@ -73,6 +73,35 @@ SEXP r_new_environment(SEXP parent, R_len_t size) {
 
 // -----------------------------------------------------------------------------
 
+// Inner types that can be coerced natively, without going through the
+// `vec_ptype_inner2()` / `vec_cast_inner()` S3 methods. Only bare atomics and
+// rrays qualify, any other class might have its own methods, so `NILSXP` is
+// returned to signal that the R level path must be used.
+
+SEXPTYPE rray_native_inner_type(SEXP x) {
+  if (OBJECT(x) && !Rf_inherits(x, "vctrs_rray")) {
+    return NILSXP;
+  }
+
+  switch (TYPEOF(x)) {
+  case LGLSXP: return LGLSXP;
+  case INTSXP: return INTSXP;
+  case REALSXP: return REALSXP;
+  default: return NILSXP;
+  }
+}
+
+SEXP rray_shared_empty(SEXPTYPE type) {
+  switch (type) {
+  case LGLSXP: return rray_shared_empty_lgl;
+  case INTSXP: return rray_shared_empty_int;
+  case REALSXP: return rray_shared_empty_dbl;
+  default: Rf_error("Internal error: No shared empty object for this type.");
+  }
+}
+
+// -----------------------------------------------------------------------------
+
 void rray_init_utils(SEXP ns) {
   rray_ns_env = ns;
 
@@ -69,7 +69,7 @@ Rcpp::RObject rray__yank_assign_impl(const xt::rarray<T>& x, Rcpp::RObject i, Rc
 // [[Rcpp::export(rng = false)]]
 Rcpp::RObject rray__yank_assign(Rcpp::RObject x, Rcpp::RObject i, Rcpp::RObject value) {
   Rcpp::RObject out;
-  DISPATCH_UNARY_TWO(out, rray__yank_assign_impl, x, i, value);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__yank_assign_impl), x, i, value);
 
   rray__set_dim_names(out, rray__dim_names(x));
 
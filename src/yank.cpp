@@ -58,7 +58,7 @@ Rcpp::RObject rray__yank_impl(const xt::rarray<T>& x, Rcpp::RObject i) {
 // [[Rcpp::export(rng = false)]]
 Rcpp::RObject rray__yank(Rcpp::RObject x, Rcpp::RObject i) {
   Rcpp::RObject out;
-  DISPATCH_UNARY_ONE(out, rray__yank_impl, x, i);
+  out = rray__dispatch_unary(RRAY_LIFT(rray__yank_impl), x, i);
 
   out.attr("dimnames") = rray__new_empty_dim_names(1);
 